@@ -0,0 +1,98 @@
+import random
+from pathlib import Path
+import click
+
+
+COMMS = ('bash', 'python3', 'nginx', 'postgres', 'kworker/0:1', 'java', 'sshd', 'node', 'rcu_sched', 'containerd')
+
+
+# Write file, creating its parent directories
+def write(path: Path, content: str):
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_text(content)
+
+
+# Single /proc/PID/stat line: 52 columns as of Linux 5.x, cpustats reads
+# comm (#2), state (#3), ppid (#4), utime (#14), stime (#15),
+# starttime (#22) and processor (#39).
+def pid_stat_line(pid: int, comm: str, ppid: int, cpu: int, rng: random.Random) -> str:
+    state = rng.choice('SSSSSRDI')
+    utime = rng.randrange(0, 100000)
+    stime = rng.randrange(0, 10000)
+    starttime = rng.randrange(0, 1000000)
+    columns = [str(pid), f'({comm})', state, str(ppid)] + ['0'] * 48
+    columns[13] = str(utime)
+    columns[14] = str(stime)
+    columns[21] = str(starttime)
+    columns[38] = str(cpu)
+    return ' '.join(columns) + '\n'
+
+
+# Synthetic /proc tree: system-wide files and NUM_TASKS processes
+def make_proc(root: Path, num_tasks: int, num_cpus: int, rng: random.Random):
+    total = [0] * 10
+    cpu_lines = []
+    for cpu in range(num_cpus):
+        values = [rng.randrange(0, 1000000) for _ in range(10)]
+        values[8] = values[9] = 0  # guest time is already a part of user time
+        total = [a + b for a, b in zip(total, values)]
+        cpu_lines.append(f'cpu{cpu} ' + ' '.join(str(v) for v in values))
+    write(root / 'stat', '\n'.join(
+        ['cpu  ' + ' '.join(str(v) for v in total), *cpu_lines,
+         'intr 0', 'ctxt 0', 'btime 0', f'processes {num_tasks}',
+         'procs_running 1', 'procs_blocked 0']) + '\n')
+    write(root / 'cpuinfo', ''.join(
+        f'processor\t: {cpu}\nmodel name\t: Fixture CPU\nphysical id\t: 0\ncore id\t\t: {cpu}\n\n'
+        for cpu in range(num_cpus)))
+    for resource in ('cpu', 'memory', 'io'):
+        write(root / 'pressure' / resource,
+              'some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n'
+              'full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n')
+    write(root / 'sys' / 'kernel' / 'perf_event_paranoid', '2\n')
+    write(root / 'self' / 'status', 'Name:\tcpustats\nCapEff:\t0000000000000000\n')
+    write(root / 'self' / 'cgroup', '0::/\n')
+
+    for pid in range(1, num_tasks + 1):
+        comm = rng.choice(COMMS)
+        ppid = 0 if pid == 1 else rng.randrange(1, pid)
+        pid_dir = root / str(pid)
+        pid_dir.mkdir(parents=True, exist_ok=True)
+        (pid_dir / 'stat').write_text(pid_stat_line(pid, comm, ppid, rng.randrange(num_cpus), rng))
+        (pid_dir / 'comm').write_text(comm + '\n')
+
+
+# Synthetic /sys tree: CPU list and topology
+def make_sys(root: Path, num_cpus: int, threads_per_core: int):
+    cpu_root = root / 'devices' / 'system' / 'cpu'
+    write(cpu_root / 'present', f'0-{num_cpus - 1}\n')
+    write(cpu_root / 'isolated', '\n')
+    for cpu in range(num_cpus):
+        write(cpu_root / f'cpu{cpu}' / 'topology' / 'core_id', f'{cpu // threads_per_core}\n')
+        write(cpu_root / f'cpu{cpu}' / 'topology' / 'physical_package_id', '0\n')
+
+
+@click.command(context_settings=dict(max_content_width=120))
+@click.option('-n', '--tasks', help='Number of processes in the /proc tree (up to 100000)',
+              type=click.IntRange(1, 100000), default=1000, show_default=True)
+@click.option('-c', '--cpus', help='Number of CPUs',
+              type=click.IntRange(1, 4096), default=8, show_default=True)
+@click.option('--smt', help='Hardware threads per core',
+              type=click.IntRange(1, 8), default=2, show_default=True)
+@click.option('-s', '--seed', help='Random seed, the same seed gives the same tree',
+              type=int, default=0, show_default=True)
+@click.argument('output', type=click.Path(file_okay=False, path_type=Path))
+def cli(output, seed, smt, cpus, tasks):
+    """
+    Generate synthetic OUTPUT/proc and OUTPUT/sys trees to benchmark
+    cpustats without a loaded machine:
+
+    cpustats --proc-root OUTPUT/proc --sys-root OUTPUT/sys -P
+    """
+    rng = random.Random(seed)
+    make_proc(output / 'proc', tasks, cpus, rng)
+    make_sys(output / 'sys', cpus, smt)
+    print(f"* generated {tasks} tasks on {cpus} CPUs in {output}")
+
+
+if __name__ == '__main__':
+    cli()
@@ -1,13 +1,17 @@
 #ifndef CPUSTATS_CONSUMER_BASE_HPP
 #define CPUSTATS_CONSUMER_BASE_HPP
 
-class Consumer {
+#include "../managers/manager_base.hpp"
+
+/** Disabled consumers (see Acceptor) are also skipped at iteration boundaries */
+class Consumer : public virtual Acceptor {
 public:
     virtual ~Consumer() = default;
 
     virtual bool Start() = 0;
-    virtual void BeginIter() = 0;
-    virtual void EndIter() = 0;
+    /** Called around updates of the managers due on a tick, see Scheduler */
+    virtual void BeginIter(SourceSet refreshed) = 0;
+    virtual void EndIter(SourceSet refreshed) = 0;
     virtual void Finish() = 0;
 };
 
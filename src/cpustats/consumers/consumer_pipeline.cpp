@@ -0,0 +1,122 @@
+#include "consumer_pipeline.hpp"
+#include "../utility/datetime.hpp"
+
+#include <cassert>
+#include <iostream>
+
+
+// --------------------------------------------------------------------------
+// ConsumerProxy
+// --------------------------------------------------------------------------
+ConsumerProxy::ConsumerProxy(ConsumerPipeline& pipeline, std::shared_ptr<Consumer> consumer, size_t index) :
+        pipeline_{pipeline},
+        consumer_{std::move(consumer)},
+        bit_{uint64_t{1} << index} {
+    std::apply([this](auto&... acceptors) {
+        ((acceptors = dynamic_cast<std::remove_reference_t<decltype(acceptors)>>(consumer_.get())), ...);
+    }, acceptors_);
+}
+
+void ConsumerProxy::Replay(TickSnapshot const& snapshot) const {
+    for (auto const& entry: snapshot.entries) {
+        if (!(entry.targets & bit_)) continue;
+        bool last_in_iter = entry.last_in_iter & bit_;
+        std::visit([this, last_in_iter](auto const& value) { Forward(value, last_in_iter); }, entry.value);
+    }
+}
+
+
+// --------------------------------------------------------------------------
+// ConsumerPipeline
+// --------------------------------------------------------------------------
+ConsumerPipeline::ConsumerPipeline(bool threaded, size_t ring_capacity) :
+        threaded_{threaded},
+        ring_{threaded ? ring_capacity : 2} {
+}
+
+void ConsumerPipeline::add_consumer(std::string name, std::shared_ptr<Consumer> consumer, SlowConsumerPolicy policy) {
+    auto& stage = stages_.emplace_back(Stage{.name = std::move(name), .consumer = std::move(consumer), .policy = policy});
+    if (threaded_) {
+        // A bit per consumer in snapshot entries
+        assert(stages_.size() <= 64);
+        stage.proxy = std::make_shared<ConsumerProxy>(*this, stage.consumer, stages_.size() - 1);
+        stage.cursor = ring_.AddCursor(policy);
+    }
+}
+
+void ConsumerPipeline::Start() {
+    for (auto& stage: stages_) {
+        if (threaded_) {
+            stage.thread = std::jthread{[this, &stage]() { Run(stage); }};
+        } else {
+            stage.consumer->Start();
+        }
+    }
+}
+
+void ConsumerPipeline::BeginIter(SourceSet refreshed) {
+    if (!threaded_) {
+        for (auto const& stage: stages_) {
+            if (stage.consumer->is_enabled()) stage.consumer->BeginIter(refreshed);
+        }
+        return;
+    }
+    recording_ = &ring_.Claim();
+    recording_->time = std::chrono::system_clock::now();
+    recording_->steady_time = std::chrono::steady_clock::now();
+    recording_->refreshed = refreshed;
+    recording_->entries.clear();
+}
+
+void ConsumerPipeline::EndIter(SourceSet refreshed) {
+    if (!threaded_) {
+        for (auto const& stage: stages_) {
+            if (stage.consumer->is_enabled()) stage.consumer->EndIter(refreshed);
+        }
+        return;
+    }
+    recording_ = nullptr;
+    ring_.Publish();
+}
+
+void ConsumerPipeline::Finish() {
+    if (!threaded_) {
+        for (auto const& stage: stages_) {
+            stage.consumer->Finish();
+        }
+        return;
+    }
+    ring_.Close();
+    for (auto& stage: stages_) {
+        stage.thread.join();
+        if (auto dropped = ring_.dropped(stage.cursor); dropped > 0) {
+            std::cerr << "Consumer " << stage.name << " fell behind, " << dropped << " ticks were skipped\n";
+        }
+    }
+}
+
+void ConsumerPipeline::Run(Stage& stage) {
+    auto& consumer = *stage.consumer;
+    consumer.Start();
+    while (auto const *snapshot = ring_.Acquire(stage.cursor)) {
+        bool in_place = stage.policy == SlowConsumerPolicy::block;
+        if (!in_place) {
+            stage.copy = *snapshot;
+            snapshot = &stage.copy;
+            ring_.Release(stage.cursor);
+        }
+        if (consumer.is_enabled()) {
+            snapshot_time = snapshot->time;
+            snapshot_steady_time = snapshot->steady_time;
+            consumer.BeginIter(snapshot->refreshed);
+            stage.proxy->Replay(*snapshot);
+            consumer.EndIter(snapshot->refreshed);
+        }
+        if (in_place) {
+            ring_.Release(stage.cursor);
+        }
+    }
+    snapshot_time.reset();
+    snapshot_steady_time.reset();
+    consumer.Finish();
+}
@@ -0,0 +1,296 @@
+#ifndef CPUSTATS_CONSUMER_PIPELINE_HPP
+#define CPUSTATS_CONSUMER_PIPELINE_HPP
+
+#include "consumer_base.hpp"
+#include "../managers/cgroup_manager.hpp"
+#include "../managers/cpu_manager.hpp"
+#include "../managers/cpuidle_manager.hpp"
+#include "../managers/perf_cpu_manager.hpp"
+#include "../managers/pid_manager.hpp"
+#include "../managers/pressure_manager.hpp"
+#include "../managers/process_tree_manager.hpp"
+#include "../managers/profile_manager.hpp"
+#include "../managers/scheduler.hpp"
+#include "../utility/snapshot_ring.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/** A value passed by a manager to acceptors */
+using SnapshotValue = std::variant<
+        CpuStat,
+        CpuInfo,
+        CpuUtil,
+        CpuQuotaUtil,
+        PidStat,
+        CpuRunQueue,
+        ThreadPlacement,
+        CpuIdleStateInfo,
+        CpuIdleResidency,
+        PressureStat,
+        CgroupCpuStat,
+        PerfCpuStat,
+        ProcessTreeStat,
+        FoldedStack,
+        TickStat,
+        std::vector<CpuUtil>,
+        std::vector<PidStat>>;
+
+/**
+ * Everything managers passed to acceptors during a tick. A value given
+ * to several consumers is stored once, with a bit per consumer.
+ */
+struct TickSnapshot {
+    struct Entry {
+        SnapshotValue value;
+        uint64_t targets{};       // bit per consumer
+        uint64_t last_in_iter{};  // bit per consumer
+        void const *source{};     // address the manager passed the value at
+    };
+
+    std::chrono::system_clock::time_point time{};
+    std::chrono::steady_clock::time_point steady_time{};  // for intervals between snapshots
+    SourceSet refreshed{};
+    std::vector<Entry> entries{};
+};
+
+class ConsumerPipeline;
+
+/**
+ * Stands in for a consumer bound to managers: values are recorded into
+ * the snapshot of the current tick and passed on by the consumer thread.
+ * Outside of ticks (managers' Init() and Finish()) they are passed on
+ * right away, as consumer threads are not running then.
+ */
+class ConsumerProxy :
+        public CpuStatAcceptor,
+        public CpuInfoAcceptor,
+        public CpuUtilAcceptor,
+        public CpuQuotaUtilAcceptor,
+        public PidStatAcceptor,
+        public CpuRunQueueAcceptor,
+        public ThreadPlacementAcceptor,
+        public CpuIdleStateInfoAcceptor,
+        public CpuIdleResidencyAcceptor,
+        public PressureStatAcceptor,
+        public CgroupCpuStatAcceptor,
+        public PerfCpuStatAcceptor,
+        public ProcessTreeStatAcceptor,
+        public FoldedStackAcceptor,
+        public TickStatAcceptor {
+public:
+    ConsumerProxy(ConsumerPipeline& pipeline, std::shared_ptr<Consumer> consumer, size_t index);
+
+    void Accept(CpuStat const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(CpuInfo const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(CpuUtil const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(CpuQuotaUtil const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(PidStat const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(CpuRunQueue const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(ThreadPlacement const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(CpuIdleStateInfo const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(CpuIdleResidency const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(PressureStat const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(CgroupCpuStat const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(PerfCpuStat const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(ProcessTreeStat const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(FoldedStack const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(TickStat const& value, bool last_in_iter) override { Record(value, last_in_iter); }
+    void Accept(std::span<const CpuUtil> values) override { RecordBatch(values); }
+    void Accept(std::span<const PidStat> values) override { RecordBatch(values); }
+
+    /** Pass values of the snapshot recorded for this consumer */
+    void Replay(TickSnapshot const& snapshot) const;
+
+    [[nodiscard]] Consumer& consumer() const { return *consumer_; }
+
+private:
+    ConsumerPipeline& pipeline_;
+    std::shared_ptr<Consumer> consumer_;
+    uint64_t bit_;
+    std::tuple<
+            CpuStatAcceptor*,
+            CpuInfoAcceptor*,
+            CpuUtilAcceptor*,
+            CpuQuotaUtilAcceptor*,
+            PidStatAcceptor*,
+            CpuRunQueueAcceptor*,
+            ThreadPlacementAcceptor*,
+            CpuIdleStateInfoAcceptor*,
+            CpuIdleResidencyAcceptor*,
+            PressureStatAcceptor*,
+            CgroupCpuStatAcceptor*,
+            PerfCpuStatAcceptor*,
+            ProcessTreeStatAcceptor*,
+            FoldedStackAcceptor*,
+            TickStatAcceptor*> acceptors_;
+
+    // Acceptor interface of a value type, only used in unevaluated context
+    static CpuStatAcceptor* AcceptorOf(CpuStat const&);
+    static CpuInfoAcceptor* AcceptorOf(CpuInfo const&);
+    static CpuUtilAcceptor* AcceptorOf(CpuUtil const&);
+    static CpuQuotaUtilAcceptor* AcceptorOf(CpuQuotaUtil const&);
+    static PidStatAcceptor* AcceptorOf(PidStat const&);
+    static CpuRunQueueAcceptor* AcceptorOf(CpuRunQueue const&);
+    static ThreadPlacementAcceptor* AcceptorOf(ThreadPlacement const&);
+    static CpuIdleStateInfoAcceptor* AcceptorOf(CpuIdleStateInfo const&);
+    static CpuIdleResidencyAcceptor* AcceptorOf(CpuIdleResidency const&);
+    static PressureStatAcceptor* AcceptorOf(PressureStat const&);
+    static CgroupCpuStatAcceptor* AcceptorOf(CgroupCpuStat const&);
+    static PerfCpuStatAcceptor* AcceptorOf(PerfCpuStat const&);
+    static ProcessTreeStatAcceptor* AcceptorOf(ProcessTreeStat const&);
+    static FoldedStackAcceptor* AcceptorOf(FoldedStack const&);
+    static TickStatAcceptor* AcceptorOf(TickStat const&);
+
+    template<typename T>
+    void Record(T const& value, bool last_in_iter);
+
+    template<typename T>
+    void RecordBatch(std::span<const T> values);
+
+    /** Entry of the current tick for the value the manager passed at the address, nullptr if not recorded yet */
+    template<typename ValueType>
+    TickSnapshot::Entry* FindEntry(void const *source) const;
+
+    template<typename T>
+    TickSnapshot::Entry& AddEntry(void const *source, T&& value);
+
+    template<typename T>
+    void Forward(T const& value, bool last_in_iter) const;
+
+    template<typename T>
+    void Forward(std::vector<T> const& values, bool) const { ForwardBatch(std::span<const T>{values}); }
+
+    template<typename T>
+    void ForwardBatch(std::span<const T> values) const;
+};
+
+/**
+ * Runs consumers, either inline on the main loop thread or each on a
+ * thread of its own. Threaded consumers read per-tick snapshots from a
+ * SnapshotRing, so slow output (a terminal, a busy disk) does not hold
+ * back sampling; how a consumer that falls behind catches up is set by
+ * its SlowConsumerPolicy.
+ */
+class ConsumerPipeline {
+public:
+    explicit ConsumerPipeline(bool threaded = false, size_t ring_capacity = 64);
+
+    void add_consumer(std::string name, std::shared_ptr<Consumer> consumer, SlowConsumerPolicy policy);
+
+    /** Acceptor to bind to managers in place of the consumer */
+    template<typename T>
+    std::shared_ptr<T> acceptor(std::shared_ptr<Consumer> const& consumer) {
+        if (!threaded_) {
+            return std::dynamic_pointer_cast<T>(consumer);
+        }
+        for (auto const& stage: stages_) {
+            if (&stage.proxy->consumer() == consumer.get()) {
+                return std::static_pointer_cast<T>(stage.proxy);
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] bool is_threaded() const { return threaded_; }
+
+    void Start();
+    void BeginIter(SourceSet refreshed);
+    void EndIter(SourceSet refreshed);
+    void Finish();
+
+private:
+    friend class ConsumerProxy;
+
+    struct Stage {
+        std::string name;
+        std::shared_ptr<Consumer> consumer;
+        std::shared_ptr<ConsumerProxy> proxy{};
+        size_t cursor{};
+        SlowConsumerPolicy policy{SlowConsumerPolicy::block};
+        TickSnapshot copy{};  // consumers that may lose snapshots do not hold ring slots
+        std::jthread thread{};
+    };
+
+    bool threaded_;
+    std::vector<Stage> stages_{};
+    SnapshotRing<TickSnapshot> ring_;
+    TickSnapshot *recording_{};  // snapshot of the current tick
+
+    void Run(Stage& stage);
+};
+
+template<typename T>
+void ConsumerProxy::Record(T const& value, bool last_in_iter) {
+    if (!pipeline_.recording_) {
+        Forward(value, last_in_iter);
+        return;
+    }
+    auto *entry = FindEntry<T>(&value);
+    if (!entry) {
+        entry = &AddEntry(&value, value);
+    }
+    entry->targets |= bit_;
+    if (last_in_iter) {
+        entry->last_in_iter |= bit_;
+    }
+}
+
+template<typename T>
+void ConsumerProxy::RecordBatch(std::span<const T> values) {
+    if (!pipeline_.recording_) {
+        ForwardBatch(values);
+        return;
+    }
+    // Values are copied once, by the first of the manager's acceptors
+    auto *entry = FindEntry<std::vector<T>>(values.data());
+    if (!entry) {
+        entry = &AddEntry(values.data(), std::vector<T>{values.begin(), values.end()});
+    }
+    entry->targets |= bit_;
+}
+
+template<typename ValueType>
+TickSnapshot::Entry* ConsumerProxy::FindEntry(void const *source) const {
+    // Managers pass a value to all their acceptors in a row
+    auto& entries = pipeline_.recording_->entries;
+    if (entries.empty() || entries.back().source != source || entries.back().targets & bit_ ||
+        !std::holds_alternative<ValueType>(entries.back().value)) {
+        return nullptr;
+    }
+    return &entries.back();
+}
+
+template<typename T>
+TickSnapshot::Entry& ConsumerProxy::AddEntry(void const *source, T&& value) {
+    auto& entry = pipeline_.recording_->entries.emplace_back();
+    entry.value = std::forward<T>(value);
+    entry.source = source;
+    return entry;
+}
+
+template<typename T>
+void ConsumerProxy::Forward(T const& value, bool last_in_iter) const {
+    using AcceptorType = std::remove_pointer_t<decltype(AcceptorOf(value))>;
+    if (auto *acceptor = std::get<AcceptorType*>(acceptors_)) {
+        acceptor->Accept(value, last_in_iter);
+    }
+}
+
+template<typename T>
+void ConsumerProxy::ForwardBatch(std::span<const T> values) const {
+    using AcceptorType = std::remove_pointer_t<decltype(AcceptorOf(std::declval<T const&>()))>;
+    if (auto *acceptor = std::get<AcceptorType*>(acceptors_)) {
+        acceptor->Accept(values);
+    }
+}
+
+#endif //CPUSTATS_CONSUMER_PIPELINE_HPP
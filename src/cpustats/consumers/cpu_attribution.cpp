@@ -0,0 +1,133 @@
+#include "cpu_attribution.hpp"
+#include "../utility/datetime.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+// Min-heap order, the least contributing thread is at the front
+constexpr auto kHeapGreater = [](auto const& a, auto const& b) {
+    return a.cpu_time > b.cpu_time;
+};
+
+}
+
+bool CpuAttributionCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "cpu"
+            << delim() << "busy"
+            << delim() << "explained"
+            << delim() << "pid"
+            << delim() << "comm"
+            << delim() << "cpu_util"
+            << std::endl;
+    }
+    return true;
+}
+
+void CpuAttributionCsvWriter::BeginIter(SourceSet refreshed) {
+    // CPU and thread deltas must cover the same interval
+    sampled_ = refreshed.Contains(Source::cpu) && refreshed.Contains(Source::pids);
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+    if (sampled_) {
+        task_cpu_times_.BeginScan();
+    }
+}
+
+void CpuAttributionCsvWriter::EndIter(SourceSet) {
+    if (!sampled_) {
+        return;
+    }
+    auto format_rate = [this](double rate) {
+        return normalize_cpu_utility_ ? fmt::format("{:.5f}", rate) : fmt::format("{:.2f}", rate * 100);
+    };
+    std::stringstream ss;
+    for (int index{}; index < static_cast<int>(cpus_.size()); index++) {
+        auto& cpu = cpus_[index];
+        if (!cpu.present || cpu.total_delta <= 0) {
+            cpu.heap.clear();
+            continue;
+        }
+        if (task_cpu_times_.has_prev()) {
+            std::sort_heap(cpu.heap.begin(), cpu.heap.end(), kHeapGreater);
+            auto explained_time = std::accumulate(
+                    cpu.heap.begin(), cpu.heap.end(), 0ull,
+                    [](auto sum, auto const& item) { return sum + item.cpu_time; });
+            auto total = static_cast<double>(cpu.total_delta);
+            auto busy = static_cast<double>(cpu.busy_delta) / total;
+            auto explained = cpu.busy_delta > 0 ? static_cast<double>(explained_time) / static_cast<double>(cpu.busy_delta) : 0.0;
+            for (auto const& item: cpu.heap) {
+                ss << iter_start_timestamp_
+                    << delim() << index
+                    << delim() << format_rate(busy)
+                    << delim() << format_rate(explained)
+                    << delim() << item.pid
+                    << delim() << item.comm.data()
+                    << delim() << format_rate(static_cast<double>(item.cpu_time) / total)
+                    << '\n';
+            }
+        }
+        cpu.heap.clear();
+    }
+    stream() << ss.str();
+    stream().flush();
+}
+
+void CpuAttributionCsvWriter::Finish() {}
+
+void CpuAttributionCsvWriter::Accept(CpuStat const& value, bool _) {
+    if (!sampled_ || value.cpu < 0) {
+        return;
+    }
+    if (value.cpu >= cpus_.size()) {
+        cpus_.resize(value.cpu + 1);
+    }
+    auto& cpu = cpus_[value.cpu];
+    CpuStat stat{value};
+    long long busy = static_cast<long long>(*stat.user()) + *stat.nice() + *stat.system()
+            + *stat.irq() + *stat.softirq();
+    long long total = std::accumulate(value.values.begin(), value.values.end(), 0ll);
+    cpu.present = true;
+    cpu.busy_delta = cpu.prev_busy >= 0 ? busy - cpu.prev_busy : 0;
+    cpu.total_delta = cpu.prev_total >= 0 ? total - cpu.prev_total : 0;
+    cpu.prev_busy = busy;
+    cpu.prev_total = total;
+}
+
+void CpuAttributionCsvWriter::Accept(PidStat const& value, bool _) {
+    Accept(std::span<const PidStat>{&value, 1});
+}
+
+void CpuAttributionCsvWriter::Accept(std::span<const PidStat> values) {
+    if (!sampled_) {
+        return;
+    }
+    for (auto const& value: values) {
+        RankTask(value);
+    }
+}
+
+void CpuAttributionCsvWriter::RankTask(PidStat const& value) {
+    if (value.state == PidStat::State::not_found) {
+        return;
+    }
+    auto delta = task_cpu_times_.Record(value).cpu_time;
+    if (delta == 0 || top_ == 0 || value.cpu < 0 || value.cpu >= cpus_.size()) {
+        return;
+    }
+    auto& heap = cpus_[value.cpu].heap;
+    if (heap.size() == top_) {
+        if (delta <= heap.front().cpu_time) {
+            return;
+        }
+        std::pop_heap(heap.begin(), heap.end(), kHeapGreater);
+        heap.pop_back();
+    }
+    heap.push_back({.cpu_time = delta, .pid = value.pid, .comm = value.comm});
+    std::push_heap(heap.begin(), heap.end(), kHeapGreater);
+}
@@ -0,0 +1,72 @@
+#ifndef CPUSTATS_CPU_ATTRIBUTION_HPP
+#define CPUSTATS_CPU_ATTRIBUTION_HPP
+
+#include "consumer_base.hpp"
+#include "csv_output.hpp"
+#include "task_cpu_times.hpp"
+#include "../managers/cpu_manager.hpp"
+#include "../managers/pid_manager.hpp"
+
+#include <array>
+#include <vector>
+
+
+/**
+ * Attributes busy time of each CPU to the threads that ran on it.
+ *
+ * CPU time of every thread during the interval (utime + stime delta)
+ * is charged to the CPU the thread was last seen on, and for each CPU
+ * the top-K threads are kept in a bounded min-heap. On every iteration
+ * the writer emits a row per top thread with its utilization and the
+ * share of the CPU busy time (user, nice, system, irq and softirq from
+ * `/proc/stat`) explained by the top threads together.
+ *
+ * A tick costs O(tasks * log K + CPUs * K * log K). Threads migrating
+ * during the interval are charged to a single CPU, so the share is an
+ * estimate and may exceed 100%.
+ */
+class CpuAttributionCsvWriter :
+        public CsvWriterBase,
+        public Consumer,
+        public CpuStatAcceptor,
+        public PidStatAcceptor {
+public:
+    void set_top(size_t top) { top_ = top; }
+    void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(CpuStat const& value, bool last_in_iter = false) override;
+    void Accept(PidStat const& value, bool last_in_cycle = false) override;
+    void Accept(std::span<const PidStat> values) override;
+
+private:
+    struct Contributor {
+        unsigned long long cpu_time{};
+        int pid{};
+        std::array<char, PidStat::kCommSize> comm{};
+    };
+
+    struct Cpu {
+        bool present{false};
+        long long prev_busy{-1};
+        long long prev_total{-1};
+        long long busy_delta{};
+        long long total_delta{};
+        std::vector<Contributor> heap{};  // min-heap by cpu_time, at most top_ items
+    };
+
+    size_t top_{3};
+    bool normalize_cpu_utility_{false};
+    std::vector<Cpu> cpus_{};  // indexed by CPU
+    TaskCpuTimes<> task_cpu_times_{};
+    bool sampled_{false};  // both CPU and thread stats were refreshed
+    std::string iter_start_timestamp_{};
+
+    void RankTask(PidStat const& value);
+};
+
+#endif //CPUSTATS_CPU_ATTRIBUTION_HPP
@@ -32,36 +32,76 @@ void CsvWriterBase::enable_header(bool enabled) {
 // CpuUtilCsvWriter
 // --------------------------------------------------------------------------
 void CpuUtilCsvWriter::set_num_cpus(int num_cpus) {
+    cpus_.clear();
+    for (int i{}; i < num_cpus; i++) {
+        cpus_.push_back(i);
+    }
     cpu_list_.resize(num_cpus);
 }
 
+void CpuUtilCsvWriter::set_cpus(std::vector<int> const& cpus) {
+    cpus_ = cpus;
+    cpu_list_.clear();
+    for (int cpu: cpus_) {
+        if (cpu >= cpu_list_.size()) {
+            cpu_list_.resize(cpu + 1);
+        }
+    }
+}
+
 bool CpuUtilCsvWriter::Start() {
     if (is_header_enabled()) {
         stream() << "timestamp";
-        for (int i{}; i < cpu_list_.size(); i++)
-            stream() << delim() << fmt::format("cpu{}", i);
+        if (quota_util_enabled_)
+            stream() << delim() << "quota";
+        for (int cpu: cpus_)
+            stream() << delim() << fmt::format("cpu{}", cpu);
+        if (run_queue_enabled_) {
+            for (int cpu: cpus_)
+                stream() << delim() << fmt::format("cpu{}_r", cpu) << delim() << fmt::format("cpu{}_d", cpu);
+        }
         stream() << std::endl;
     }
     return true;
 }
 
-void CpuUtilCsvWriter::BeginIter() {
+void CpuUtilCsvWriter::BeginIter(SourceSet refreshed) {
     iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
     for (auto& cpu: cpu_list_) {
         cpu = std::nullopt;
     }
+    quota_util_ = std::nullopt;
+    // Run queues come from the PID scan, which may be less frequent:
+    // rows repeat the latest counts until the next scan
+    if (refreshed.Contains(Source::pids) || run_queues_.size() != cpu_list_.size()) {
+        run_queues_.assign(cpu_list_.size(), std::nullopt);
+    }
 }
 
-void CpuUtilCsvWriter::EndIter() {
+void CpuUtilCsvWriter::EndIter(SourceSet refreshed) {
+    if (!refreshed.Contains(Source::cpu)) {
+        return;
+    }
+    auto format_util = [this](std::optional<double> const& value) {
+        if (!value) {
+            return std::string{};
+        }
+        return normalize_cpu_utility_ ? fmt::format("{:.5f}", *value) : fmt::format("{:.2f}", *value * 100);
+    };
     std::stringstream ss;
     ss << iter_start_timestamp_;
-    for (auto const& cpu: cpu_list_) {
-        ss << delim();
-        if (cpu) {
-            if (normalize_cpu_utility_) {
-                ss << fmt::format("{:.5f}", *cpu);
+    if (quota_util_enabled_) {
+        ss << delim() << format_util(quota_util_);
+    }
+    for (int cpu: cpus_) {
+        ss << delim() << format_util(cpu_list_[cpu]);
+    }
+    if (run_queue_enabled_) {
+        for (int cpu: cpus_) {
+            if (auto const& run_queue = run_queues_[cpu]) {
+                ss << delim() << run_queue->running << delim() << run_queue->waiting;
             } else {
-                ss << fmt::format("{:.2f}", *cpu * 100);
+                ss << delim() << delim();
             }
         }
     }
@@ -79,6 +119,24 @@ void CpuUtilCsvWriter::Accept(CpuUtil const& value, bool last_in_cycle) {
     }
 }
 
+void CpuUtilCsvWriter::Accept(std::span<const CpuUtil> values) {
+    for (auto const& value: values) {
+        if (value.cpu >= 0 && value.cpu < cpu_list_.size()) {
+            cpu_list_[value.cpu] = value.busy_rate;
+        }
+    }
+}
+
+void CpuUtilCsvWriter::Accept(CpuQuotaUtil const& value, bool last_in_cycle) {
+    quota_util_ = value.busy_rate;
+}
+
+void CpuUtilCsvWriter::Accept(CpuRunQueue const& value, bool last_in_cycle) {
+    if (value.cpu >= 0 && value.cpu < run_queues_.size()) {
+        run_queues_[value.cpu] = value;
+    }
+}
+
 
 // --------------------------------------------------------------------------
 // PidCpuCsvWriter
@@ -88,27 +146,416 @@ bool PidCpuCsvWriter::Start() {
         stream() << "timestamp"
             << delim() << "pid"
             << delim() << "cpu"
-            << delim() << "state"
-            << std::endl;
+            << delim() << "state";
+        if (perf_columns_enabled_) {
+            stream() << delim() << "on_cpu_ns"
+                << delim() << "context_switches"
+                << delim() << "migrations"
+                << delim() << "ipc";
+        }
+        if (migration_columns_enabled_) {
+            stream() << delim() << "migration"
+                << delim() << "migrations_smt"
+                << delim() << "migrations_socket"
+                << delim() << "migrations_cross_socket";
+        }
+        if (affinity_column_enabled_) {
+            stream() << delim() << "affinity_violation";
+        }
+        stream() << std::endl;
         stream().flush();
     }
     return true;
 }
 
-void PidCpuCsvWriter::BeginIter() {
+void PidCpuCsvWriter::BeginIter(SourceSet) {
     iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
 }
 
-void PidCpuCsvWriter::EndIter() {
+void PidCpuCsvWriter::EndIter(SourceSet) {
     stream().flush();
 }
 
 void PidCpuCsvWriter::Finish() {}
 
 void PidCpuCsvWriter::Accept(PidStat const& value, bool _) {
+    Accept(std::span<const PidStat>{&value, 1});
+}
+
+void PidCpuCsvWriter::Accept(std::span<const PidStat> values) {
+    rows_.clear();
+    auto out = std::back_inserter(rows_);
+    auto d = delim();
+    for (auto const& value: values) {
+        fmt::format_to(out, "{}{}{}{}{}{}{}", iter_start_timestamp_, d, value.pid, d, value.cpu, d, ToString(value.state));
+        if (perf_columns_enabled_) {
+            if (auto const& perf = value.perf) {
+                fmt::format_to(out, "{}{}{}{}{}{}{}", d, perf->task_clock_ns, d, perf->context_switches, d, perf->migrations, d);
+                if (perf->cycles && perf->instructions && *perf->cycles > 0) {
+                    fmt::format_to(out, "{:.3f}", static_cast<double>(*perf->instructions) / *perf->cycles);
+                }
+            } else {
+                fmt::format_to(out, "{}{}{}{}", d, d, d, d);
+            }
+        }
+        if (migration_columns_enabled_) {
+            if (auto const& migrations = value.migrations) {
+                fmt::format_to(out, "{}{}{}{}{}{}{}{}", d, ToString(migrations->last), d, migrations->smt,
+                               d, migrations->same_socket, d, migrations->cross_socket);
+            } else {
+                fmt::format_to(out, "{}{}{}{}", d, d, d, d);
+            }
+        }
+        if (affinity_column_enabled_) {
+            fmt::format_to(out, "{}{}", d, ToString(value.affinity_violation));
+        }
+        rows_.push_back('\n');
+    }
+    stream().write(rows_.data(), static_cast<std::streamsize>(rows_.size()));
+}
+
+
+// --------------------------------------------------------------------------
+// PlacementMatrixCsvWriter
+// --------------------------------------------------------------------------
+bool PlacementMatrixCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "pid"
+            << delim() << "comm"
+            << delim() << "migrations_smt"
+            << delim() << "migrations_socket"
+            << delim() << "migrations_cross_socket";
+        for (int cpu{}; cpu < num_cpus_; cpu++)
+            stream() << delim() << fmt::format("cpu{}", cpu);
+        stream() << std::endl;
+    }
+    return true;
+}
+
+void PlacementMatrixCsvWriter::BeginIter(SourceSet) {}
+
+void PlacementMatrixCsvWriter::EndIter(SourceSet) {}
+
+void PlacementMatrixCsvWriter::Finish() {}
+
+void PlacementMatrixCsvWriter::Accept(ThreadPlacement const& value, bool last_in_iter) {
+    stream() << value.pid
+        << delim() << value.comm.data()
+        << delim() << value.migrations.smt
+        << delim() << value.migrations.same_socket
+        << delim() << value.migrations.cross_socket;
+    for (int cpu{}; cpu < num_cpus_; cpu++) {
+        stream() << delim() << (cpu < value.residency.size() ? value.residency[cpu] : 0);
+    }
+    stream() << '\n';
+    if (last_in_iter) {
+        stream().flush();
+    }
+}
+
+
+// --------------------------------------------------------------------------
+// CpuIdleCsvWriter
+// --------------------------------------------------------------------------
+bool CpuIdleCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp" << delim() << "cpu";
+        for (auto const& name: state_names_)
+            stream() << delim() << name;
+        for (auto const& name: state_names_)
+            stream() << delim() << name << "_per_sec";
+        stream() << std::endl;
+    }
+    return true;
+}
+
+void CpuIdleCsvWriter::BeginIter(SourceSet) {
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+}
+
+void CpuIdleCsvWriter::EndIter(SourceSet) {
+    stream().flush();
+}
+
+void CpuIdleCsvWriter::Finish() {}
+
+void CpuIdleCsvWriter::Accept(CpuIdleStateInfo const& value, bool _) {
+    // CPUs may expose different number of states, so keep the longest list
+    if (value.state >= state_names_.size()) {
+        state_names_.resize(value.state + 1);
+    }
+    if (state_names_[value.state].empty()) {
+        state_names_[value.state] = value.name;
+    }
+}
+
+void CpuIdleCsvWriter::Accept(CpuIdleResidency const& value, bool _) {
+    std::stringstream ss;
+    ss << iter_start_timestamp_ << delim() << value.cpu;
+    for (size_t i{}; i < state_names_.size(); i++) {
+        ss << delim();
+        if (i < value.residency.size()) {
+            if (normalize_cpu_utility_) {
+                ss << fmt::format("{:.5f}", value.residency[i]);
+            } else {
+                ss << fmt::format("{:.2f}", value.residency[i] * 100);
+            }
+        }
+    }
+    for (size_t i{}; i < state_names_.size(); i++) {
+        ss << delim();
+        if (i < value.entry_rate.size()) {
+            ss << fmt::format("{:.1f}", value.entry_rate[i]);
+        }
+    }
+    ss << std::endl;
+    stream() << ss.str();
+}
+
+
+// --------------------------------------------------------------------------
+// PressureCsvWriter
+// --------------------------------------------------------------------------
+bool PressureCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "source"
+            << delim() << "resource"
+            << delim() << "some"
+            << delim() << "full"
+            << std::endl;
+    }
+    return true;
+}
+
+void PressureCsvWriter::BeginIter(SourceSet) {
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+}
+
+void PressureCsvWriter::EndIter(SourceSet) {
+    stream().flush();
+}
+
+void PressureCsvWriter::Finish() {}
+
+void PressureCsvWriter::Accept(PressureStat const& value, bool _) {
+    auto format_rate = [this](double rate) {
+        return normalize_cpu_utility_ ? fmt::format("{:.5f}", rate) : fmt::format("{:.2f}", rate * 100);
+    };
+    stream() << iter_start_timestamp_
+        << delim() << value.source
+        << delim() << ToString(value.resource)
+        << delim() << format_rate(value.some_rate)
+        << delim() << (value.full_rate ? format_rate(*value.full_rate) : "")
+        << std::endl;
+}
+
+
+// --------------------------------------------------------------------------
+// CgroupCsvWriter
+// --------------------------------------------------------------------------
+bool CgroupCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "cgroup"
+            << delim() << "usage"
+            << delim() << "user"
+            << delim() << "system"
+            << delim() << "nr_periods"
+            << delim() << "nr_throttled"
+            << delim() << "throttled_usec"
+            << std::endl;
+    }
+    return true;
+}
+
+void CgroupCsvWriter::BeginIter(SourceSet) {
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+}
+
+void CgroupCsvWriter::EndIter(SourceSet) {
+    stream().flush();
+}
+
+void CgroupCsvWriter::Finish() {}
+
+void CgroupCsvWriter::Accept(CgroupCpuStat const& value, bool _) {
+    auto format_rate = [this](double rate) {
+        return normalize_cpu_utility_ ? fmt::format("{:.5f}", rate) : fmt::format("{:.2f}", rate * 100);
+    };
     stream() << iter_start_timestamp_
-        << delim() << value.pid
+        << delim() << value.path
+        << delim() << format_rate(value.usage_rate)
+        << delim() << format_rate(value.user_rate)
+        << delim() << format_rate(value.system_rate)
+        << delim() << value.nr_periods
+        << delim() << value.nr_throttled
+        << delim() << value.throttled_usec
+        << '\n';
+}
+
+
+// --------------------------------------------------------------------------
+// PerfCpuCsvWriter
+// --------------------------------------------------------------------------
+bool PerfCpuCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "cpu"
+            << delim() << "clock_ns"
+            << delim() << "busy_ns"
+            << delim() << "busy"
+            << delim() << "context_switches_per_sec"
+            << delim() << "migrations_per_sec"
+            << delim() << "page_faults_per_sec"
+            << delim() << "cycles_per_sec"
+            << delim() << "instructions_per_sec"
+            << delim() << "ipc"
+            << std::endl;
+    }
+    return true;
+}
+
+void PerfCpuCsvWriter::BeginIter(SourceSet) {
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+}
+
+void PerfCpuCsvWriter::EndIter(SourceSet) {
+    stream().flush();
+}
+
+void PerfCpuCsvWriter::Finish() {}
+
+void PerfCpuCsvWriter::Accept(PerfCpuStat const& value, bool _) {
+    std::stringstream ss;
+    ss << iter_start_timestamp_
         << delim() << value.cpu
-        << delim() << ToString(value.state)
+        << delim() << value.clock_ns
+        << delim();
+    if (value.busy_ns) {
+        double busy = static_cast<double>(*value.busy_ns) / static_cast<double>(value.clock_ns);
+        ss << *value.busy_ns << delim()
+            << (normalize_cpu_utility_ ? fmt::format("{:.5f}", busy) : fmt::format("{:.2f}", busy * 100));
+    } else {
+        ss << delim();
+    }
+    ss << delim() << fmt::format("{:.1f}", value.context_switches_rate)
+        << delim() << fmt::format("{:.1f}", value.migrations_rate)
+        << delim() << fmt::format("{:.1f}", value.page_faults_rate)
+        << delim();
+    if (value.cycles_rate) {
+        ss << fmt::format("{:.0f}", *value.cycles_rate);
+    }
+    ss << delim();
+    if (value.instructions_rate) {
+        ss << fmt::format("{:.0f}", *value.instructions_rate);
+    }
+    ss << delim();
+    if (value.cycles_rate && value.instructions_rate && *value.cycles_rate > 0) {
+        ss << fmt::format("{:.3f}", *value.instructions_rate / *value.cycles_rate);
+    }
+    ss << '\n';
+    stream() << ss.str();
+}
+
+
+// --------------------------------------------------------------------------
+// ProcessTreeCsvWriter
+// --------------------------------------------------------------------------
+bool ProcessTreeCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "root"
+            << delim() << "pid"
+            << delim() << "ppid"
+            << delim() << "processes"
+            << delim() << "cpu_util"
+            << delim() << "cpus"
+            << std::endl;
+    }
+    return true;
+}
+
+void ProcessTreeCsvWriter::BeginIter(SourceSet) {
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+}
+
+void ProcessTreeCsvWriter::EndIter(SourceSet) {
+    stream().flush();
+}
+
+void ProcessTreeCsvWriter::Finish() {}
+
+void ProcessTreeCsvWriter::Accept(ProcessTreeStat const& value, bool _) {
+    auto format_rate = [this](double rate) {
+        return normalize_cpu_utility_ ? fmt::format("{:.5f}", rate) : fmt::format("{:.2f}", rate * 100);
+    };
+    // Aggregated row has no pid, per-child rows follow it
+    std::stringstream ss;
+    ss << iter_start_timestamp_
+        << delim() << value.root_pid
+        << delim()
+        << delim()
+        << delim() << value.num_processes
+        << delim() << format_rate(value.cpu_rate)
+        << delim();
+    for (size_t i{}; i < value.cpus.size(); i++) {
+        if (i > 0) ss << ',';
+        ss << value.cpus[i];
+    }
+    ss << '\n';
+    for (auto const& member: value.members) {
+        ss << iter_start_timestamp_
+            << delim() << value.root_pid
+            << delim() << member.pid
+            << delim() << member.ppid
+            << delim() << 1
+            << delim() << format_rate(member.cpu_rate)
+            << delim() << member.cpu
+            << '\n';
+    }
+    stream() << ss.str();
+}
+
+
+// --------------------------------------------------------------------------
+// TickCsvWriter
+// --------------------------------------------------------------------------
+bool TickCsvWriter::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "sources"
+            << delim() << "sample_ms"
+            << delim() << "skew_ms"
+            << std::endl;
+    }
+    return true;
+}
+
+void TickCsvWriter::BeginIter(SourceSet) {
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+}
+
+void TickCsvWriter::EndIter(SourceSet) {
+    stream().flush();
+}
+
+void TickCsvWriter::Finish() {}
+
+void TickCsvWriter::Accept(TickStat const& value, bool _) {
+    auto to_ms = [](std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+    std::string sources{};
+    for (int i{}; i <= static_cast<int>(Source::process_tree); i++) {
+        auto source = static_cast<Source>(i);
+        if (!value.refreshed.Contains(source)) continue;
+        if (!sources.empty()) sources += ',';
+        sources += ToString(source);
+    }
+    stream() << iter_start_timestamp_
+        << delim() << sources
+        << delim() << fmt::format("{:.3f}", to_ms(value.sample_time))
+        << delim() << fmt::format("{:.3f}", to_ms(value.skew))
         << std::endl;
 }
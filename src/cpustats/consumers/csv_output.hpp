@@ -2,13 +2,22 @@
 #define CPUSTATS_CSV_OUTPUT_HPP
 
 #include "consumer_base.hpp"
+#include "../managers/cgroup_manager.hpp"
 #include "../managers/cpu_manager.hpp"
+#include "../managers/cpuidle_manager.hpp"
+#include "../managers/perf_cpu_manager.hpp"
 #include "../managers/pid_manager.hpp"
+#include "../managers/pressure_manager.hpp"
+#include "../managers/process_tree_manager.hpp"
+#include "../managers/scheduler.hpp"
+
+#include <fmt/format.h>
 
 #include <chrono>
 #include <fstream>
 #include <iostream>
 #include <optional>
+#include <span>
 
 class CsvWriterBase {
 public:
@@ -28,32 +37,177 @@ private:
     bool header_enabled_{true};
 };
 
-class CpuUtilCsvWriter : public CsvWriterBase, public Consumer, public CpuUtilAcceptor {
+class CpuUtilCsvWriter :
+        public CsvWriterBase,
+        public Consumer,
+        public CpuUtilAcceptor,
+        public CpuQuotaUtilAcceptor,
+        public CpuRunQueueAcceptor {
 public:
     void set_num_cpus(int num_cpus);
+    void set_cpus(std::vector<int> const& cpus);
+    void enable_quota_util(bool enabled) { quota_util_enabled_ = enabled; }
+    void enable_run_queue(bool enabled) { run_queue_enabled_ = enabled; }
     void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
 
     bool Start() override;
-    void BeginIter() override;
-    void EndIter() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
     void Finish() override;
 
     void Accept(CpuUtil const& value, bool last_in_cycle = false) override;
+    void Accept(std::span<const CpuUtil> values) override;
+    void Accept(CpuQuotaUtil const& value, bool last_in_cycle = false) override;
+    void Accept(CpuRunQueue const& value, bool last_in_cycle = false) override;
 private:
     bool normalize_cpu_utility_{false};
+    bool quota_util_enabled_{false};
+    bool run_queue_enabled_{false};
     std::string iter_start_timestamp_{};
-    std::vector<std::optional<double>> cpu_list_{};
+    std::vector<int> cpus_{};                        // CPUs to write, in columns order
+    std::vector<std::optional<double>> cpu_list_{};  // indexed by CPU
+    std::optional<double> quota_util_{};
+    std::vector<std::optional<CpuRunQueue>> run_queues_{};  // indexed by CPU
 };
 
 
 class PidCpuCsvWriter : public CsvWriterBase, public Consumer, public PidStatAcceptor {
 public:
+    void enable_perf_columns(bool enabled) { perf_columns_enabled_ = enabled; }
+    void enable_migration_columns(bool enabled) { migration_columns_enabled_ = enabled; }
+    void enable_affinity_column(bool enabled) { affinity_column_enabled_ = enabled; }
+
     bool Start() override;
-    void BeginIter() override;
-    void EndIter() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
     void Finish() override;
 
     void Accept(PidStat const& value, bool last_in_cycle = false) override;
+    void Accept(std::span<const PidStat> values) override;
+private:
+    bool perf_columns_enabled_{false};
+    bool migration_columns_enabled_{false};
+    bool affinity_column_enabled_{false};
+    std::string iter_start_timestamp_{};
+    fmt::memory_buffer rows_{};  // rows of a tick, written at once
+};
+
+
+/**
+ * Writes thread x CPU residency matrix: number of observations of
+ * every thread on each CPU during the run, and its migrations. Rows of
+ * exited threads are written as they exit, the rest at the end.
+ */
+class PlacementMatrixCsvWriter : public CsvWriterBase, public Consumer, public ThreadPlacementAcceptor {
+public:
+    void set_num_cpus(int num_cpus) { num_cpus_ = num_cpus; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(ThreadPlacement const& value, bool last_in_iter = false) override;
+private:
+    int num_cpus_{};
+};
+
+
+class CpuIdleCsvWriter :
+        public CsvWriterBase,
+        public Consumer,
+        public CpuIdleStateInfoAcceptor,
+        public CpuIdleResidencyAcceptor {
+public:
+    void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(CpuIdleStateInfo const& value, bool last_in_iter = false) override;
+    void Accept(CpuIdleResidency const& value, bool last_in_iter = false) override;
+private:
+    bool normalize_cpu_utility_{false};
+    std::string iter_start_timestamp_{};
+    std::vector<std::string> state_names_{};
+};
+
+
+class PressureCsvWriter : public CsvWriterBase, public Consumer, public PressureStatAcceptor {
+public:
+    void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(PressureStat const& value, bool last_in_iter = false) override;
+private:
+    bool normalize_cpu_utility_{false};
+    std::string iter_start_timestamp_{};
+};
+
+
+class CgroupCsvWriter : public CsvWriterBase, public Consumer, public CgroupCpuStatAcceptor {
+public:
+    void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(CgroupCpuStat const& value, bool last_in_iter = false) override;
+private:
+    bool normalize_cpu_utility_{false};
+    std::string iter_start_timestamp_{};
+};
+
+
+class PerfCpuCsvWriter : public CsvWriterBase, public Consumer, public PerfCpuStatAcceptor {
+public:
+    void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(PerfCpuStat const& value, bool last_in_iter = false) override;
+private:
+    bool normalize_cpu_utility_{false};
+    std::string iter_start_timestamp_{};
+};
+
+
+class ProcessTreeCsvWriter : public CsvWriterBase, public Consumer, public ProcessTreeStatAcceptor {
+public:
+    void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(ProcessTreeStat const& value, bool last_in_iter = false) override;
+private:
+    bool normalize_cpu_utility_{false};
+    std::string iter_start_timestamp_{};
+};
+
+
+/** One row per tick: sources refreshed, how long sampling took and the skew between sources */
+class TickCsvWriter : public CsvWriterBase, public Consumer, public TickStatAcceptor {
+public:
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(TickStat const& value, bool last_in_iter) override;
 private:
     std::string iter_start_timestamp_{};
 };
@@ -0,0 +1,103 @@
+#include "d_state_watchdog.hpp"
+#include "../utility/datetime.hpp"
+
+#include <fmt/format.h>
+
+#include <sstream>
+
+
+bool DStateWatchdog::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "pid"
+            << delim() << "d_state_ms"
+            << delim() << "wchan"
+            << delim() << "stack"
+            << std::endl;
+    }
+    return true;
+}
+
+void DStateWatchdog::BeginIter(SourceSet refreshed) {
+    if (!refreshed.Contains(Source::pids)) {
+        return;
+    }
+    // Time is taken once per iteration, not per thread
+    iter_time_ = GetSteadyCurrentTime();
+    iter_start_timestamp_.clear();
+    generation_++;
+}
+
+void DStateWatchdog::EndIter(SourceSet refreshed) {
+    // Forget threads that left D state or disappeared
+    if (refreshed.Contains(Source::pids) && !stalls_.empty()) {
+        std::erase_if(stalls_, [this](auto const& item) {
+            return item.second.generation != generation_;
+        });
+    }
+}
+
+void DStateWatchdog::Finish() {
+    if (suppressed_ > 0) {
+        stream() << "# " << suppressed_ << " captures suppressed by rate limit" << std::endl;
+    }
+    stream().flush();
+}
+
+void DStateWatchdog::Accept(PidStat const& value, bool _) {
+    Accept(std::span<const PidStat>{&value, 1});
+}
+
+void DStateWatchdog::Accept(std::span<const PidStat> values) {
+    for (auto const& value: values) {
+        if (value.state == PidStat::State::waiting) {
+            TrackTask(value);
+        }
+    }
+}
+
+void DStateWatchdog::TrackTask(PidStat const& value) {
+    auto [it, inserted] = stalls_.try_emplace(value.pid);
+    auto& stall = it->second;
+    if (inserted || stall.starttime != value.starttime) {
+        stall = Stall{.since = iter_time_, .starttime = value.starttime};
+    }
+    stall.generation = generation_;
+    if (stall.captured || iter_time_ - stall.since < threshold_) {
+        return;
+    }
+    stall.captured = true;
+
+    if (iter_time_ - window_start_ >= std::chrono::seconds(1)) {
+        window_start_ = iter_time_;
+        window_captures_ = 0;
+    }
+    if (window_captures_ >= max_captures_per_sec_) {
+        suppressed_++;
+        return;
+    }
+    window_captures_++;
+    Capture(value, stall);
+}
+
+void DStateWatchdog::Capture(PidStat const& value, Stall const& stall) {
+    if (iter_start_timestamp_.empty()) {
+        iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+    }
+    auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(iter_time_ - stall.since).count();
+    std::stringstream ss;
+    ss << iter_start_timestamp_
+        << delim() << value.pid
+        << delim() << duration_ms
+        << delim() << ReadProcPidWchan(value.pid).value_or("")
+        << delim();
+    if (auto frames = ReadProcPidKernelStack(value.pid)) {
+        for (size_t i{}; i < frames->size(); i++) {
+            if (i > 0) ss << '<';
+            ss << (*frames)[i];
+        }
+    }
+    ss << std::endl;
+    stream() << ss.str();
+    stream().flush();
+}
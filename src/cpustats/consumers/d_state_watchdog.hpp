@@ -0,0 +1,58 @@
+#ifndef CPUSTATS_D_STATE_WATCHDOG_HPP
+#define CPUSTATS_D_STATE_WATCHDOG_HPP
+
+#include "consumer_base.hpp"
+#include "csv_output.hpp"
+#include "../managers/pid_manager.hpp"
+
+#include <chrono>
+#include <unordered_map>
+
+
+/**
+ * Detects threads staying in uninterruptible sleep (D state) longer
+ * than a threshold. For each such stall, the kernel wait channel and,
+ * if permitted, the kernel stack are captured once and written as a
+ * CSV event. Captures are limited to `max_captures_per_sec`.
+ *
+ * Only threads observed in D state are stored, so for other threads
+ * the cost is a comparison of the already parsed state.
+ */
+class DStateWatchdog : public CsvWriterBase, public Consumer, public PidStatAcceptor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void set_threshold(Clock::duration threshold) { threshold_ = threshold; }
+    void set_max_captures_per_sec(int value) { max_captures_per_sec_ = value; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(PidStat const& value, bool last_in_cycle = false) override;
+    void Accept(std::span<const PidStat> values) override;
+
+private:
+    struct Stall {
+        Clock::time_point since{};
+        unsigned long long starttime{};
+        bool captured{false};
+        unsigned generation{};
+    };
+
+    Clock::duration threshold_{std::chrono::seconds(1)};
+    int max_captures_per_sec_{10};
+    std::unordered_map<int, Stall> stalls_{};
+    unsigned generation_{};
+    Clock::time_point iter_time_{};
+    std::string iter_start_timestamp_{};
+    Clock::time_point window_start_{};
+    int window_captures_{};
+    uint64_t suppressed_{};
+
+    void TrackTask(PidStat const& value);
+    void Capture(PidStat const& value, Stall const& stall);
+};
+
+#endif //CPUSTATS_D_STATE_WATCHDOG_HPP
@@ -0,0 +1,21 @@
+#include "folded_stacks.hpp"
+
+FoldedStacksWriter::FoldedStacksWriter(std::ofstream &&stream)
+: stream_(std::move(stream)) {}
+
+bool FoldedStacksWriter::Start() {
+    return stream_.is_open();
+}
+
+void FoldedStacksWriter::BeginIter(SourceSet) {}
+
+void FoldedStacksWriter::EndIter(SourceSet) {}
+
+void FoldedStacksWriter::Finish() {}
+
+void FoldedStacksWriter::Accept(FoldedStack const& value, bool last_in_iter) {
+    stream_ << value.stack << ' ' << value.count << '\n';
+    if (last_in_iter) {
+        stream_.flush();
+    }
+}
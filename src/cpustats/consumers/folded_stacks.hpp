@@ -0,0 +1,27 @@
+#ifndef CPUSTATS_FOLDED_STACKS_HPP
+#define CPUSTATS_FOLDED_STACKS_HPP
+
+#include "consumer_base.hpp"
+#include "../managers/profile_manager.hpp"
+
+#include <fstream>
+
+/**
+ * Writes collapsed stacks, one "stack count" line each, ready for
+ * `flamegraph.pl`. Stacks arrive when the profiler finishes.
+ */
+class FoldedStacksWriter : public Consumer, public FoldedStackAcceptor {
+public:
+    explicit FoldedStacksWriter(std::ofstream&& stream);
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(FoldedStack const& value, bool last_in_iter = false) override;
+private:
+    std::ofstream stream_{};
+};
+
+#endif //CPUSTATS_FOLDED_STACKS_HPP
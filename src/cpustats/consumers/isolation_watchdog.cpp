@@ -0,0 +1,134 @@
+#include "isolation_watchdog.hpp"
+#include "../utility/datetime.hpp"
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include <sstream>
+
+
+void IsolationWatchdog::set_isolated_cpus(std::vector<int> const& cpus) {
+    isolated_cpus_ = cpus;
+    isolated_mask_ = CpuMask{cpus};
+    cpus_.clear();
+    for (int cpu: cpus) {
+        if (cpu >= cpus_.size()) {
+            cpus_.resize(cpu + 1);
+        }
+    }
+}
+
+bool IsolationWatchdog::Start() {
+    if (auto ticks = sysconf(_SC_CLK_TCK); ticks > 0) {
+        ms_per_tick_ = 1000.0 / static_cast<double>(ticks);
+    }
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << "cpu"
+            << delim() << "irq_ms"
+            << delim() << "softirq_ms"
+            << delim() << "intruders"
+            << std::endl;
+    }
+    return true;
+}
+
+void IsolationWatchdog::BeginIter(SourceSet refreshed) {
+    // Interrupt time and intruders are reported for the same interval
+    sampled_ = refreshed.Contains(Source::cpu) && refreshed.Contains(Source::pids);
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+    for (auto& cpu: cpus_) {
+        cpu.intruders.clear();
+    }
+}
+
+void IsolationWatchdog::EndIter(SourceSet) {
+    if (!sampled_) {
+        return;
+    }
+    std::stringstream ss;
+    for (int index: isolated_cpus_) {
+        auto const& cpu = cpus_[index];
+        ss << iter_start_timestamp_
+            << delim() << index
+            << delim() << cpu.irq_delta * ms_per_tick_
+            << delim() << cpu.softirq_delta * ms_per_tick_
+            << delim();
+        for (size_t i{}; i < cpu.intruders.size(); i++) {
+            if (i > 0) ss << ',';
+            ss << cpu.intruders[i].pid << ':' << cpu.intruders[i].comm.data();
+        }
+        ss << '\n';
+        num_intrusions_ += cpu.intruders.size();
+    }
+    stream() << ss.str();
+    stream().flush();
+    std::swap(tasks_, prev_tasks_);
+    tasks_.Clear();
+    has_prev_ = true;
+}
+
+void IsolationWatchdog::Finish() {
+    stream() << "# " << num_intrusions_ << " task observations on isolated CPUs" << std::endl;
+}
+
+void IsolationWatchdog::Accept(CpuStat const& value, bool _) {
+    if (!sampled_ || !isolated_mask_.Test(value.cpu)) {
+        return;
+    }
+    auto& cpu = cpus_[value.cpu];
+    CpuStat stat{value};
+    cpu.irq_delta = cpu.prev_irq >= 0 ? *stat.irq() - cpu.prev_irq : 0;
+    cpu.softirq_delta = cpu.prev_softirq >= 0 ? *stat.softirq() - cpu.prev_softirq : 0;
+    cpu.prev_irq = *stat.irq();
+    cpu.prev_softirq = *stat.softirq();
+}
+
+void IsolationWatchdog::Accept(PidStat const& value, bool _) {
+    Accept(std::span<const PidStat>{&value, 1});
+}
+
+void IsolationWatchdog::Accept(std::span<const PidStat> values) {
+    if (!sampled_) {
+        return;
+    }
+    for (auto const& value: values) {
+        CheckTask(value);
+    }
+}
+
+void IsolationWatchdog::CheckTask(PidStat const& value) {
+    if (!isolated_mask_.Test(value.cpu) || value.state == PidStat::State::not_found) {
+        return;
+    }
+    if (IsAllowed(value.comm.data())) {
+        return;
+    }
+    auto cpu_time = value.utime + value.stime;
+    auto [task, inserted] = tasks_.TryEmplace(value.pid);
+    if (!inserted) {
+        return;
+    }
+    *task = Task{.starttime = value.starttime, .cpu_time = cpu_time};
+    // Sleeping task only tells where it ran last time, it is an intruder
+    // if it ran during the interval
+    bool ran = value.state == PidStat::State::running;
+    if (!ran && has_prev_) {
+        auto const *prev = prev_tasks_.Find(value.pid);
+        ran = !prev || prev->starttime != value.starttime || prev->cpu_time != cpu_time;
+    }
+    if (!ran) {
+        return;
+    }
+    cpus_[value.cpu].intruders.push_back({.pid = value.pid, .comm = value.comm});
+}
+
+bool IsolationWatchdog::IsAllowed(const char *comm) const {
+    std::string_view name{comm};
+    for (auto const& prefix: allowed_comms_) {
+        if (name.starts_with(prefix)) {
+            return true;
+        }
+    }
+    return false;
+}
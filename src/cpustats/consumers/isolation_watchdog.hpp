@@ -0,0 +1,80 @@
+#ifndef CPUSTATS_ISOLATION_WATCHDOG_HPP
+#define CPUSTATS_ISOLATION_WATCHDOG_HPP
+
+#include "consumer_base.hpp"
+#include "csv_output.hpp"
+#include "../managers/cpu_manager.hpp"
+#include "../managers/pid_manager.hpp"
+#include "../system/cpu_mask.hpp"
+#include "../utility/flat_hash_map.hpp"
+
+#include <string>
+#include <vector>
+
+
+/**
+ * Detects interference on isolated (`isolcpus`, `nohz_full`) CPUs.
+ *
+ * For every isolated CPU, a row per iteration is written with the time
+ * spent in hard and soft interrupts and the tasks that ran on the CPU
+ * (are running, or consumed CPU time since the previous iteration)
+ * whose command name does not start with any of the allowed prefixes.
+ *
+ * A task on a not isolated CPU costs a single bit test. CPU time is
+ * remembered only for tasks last seen on isolated CPUs, in flat hash
+ * maps reused across iterations.
+ */
+class IsolationWatchdog :
+        public CsvWriterBase,
+        public Consumer,
+        public CpuStatAcceptor,
+        public PidStatAcceptor {
+public:
+    void set_isolated_cpus(std::vector<int> const& cpus);
+    void set_allowed_comms(std::vector<std::string> prefixes) { allowed_comms_ = std::move(prefixes); }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(CpuStat const& value, bool last_in_iter = false) override;
+    void Accept(PidStat const& value, bool last_in_cycle = false) override;
+    void Accept(std::span<const PidStat> values) override;
+
+private:
+    struct Intruder {
+        int pid{};
+        std::array<char, PidStat::kCommSize> comm{};
+    };
+
+    struct Task {
+        unsigned long long starttime{};
+        unsigned long long cpu_time{};
+    };
+
+    struct Cpu {
+        int prev_irq{-1};
+        int prev_softirq{-1};
+        int irq_delta{};
+        int softirq_delta{};
+        std::vector<Intruder> intruders{};
+    };
+
+    std::vector<int> isolated_cpus_{};
+    CpuMask isolated_mask_{};
+    std::vector<Cpu> cpus_{};  // indexed by CPU
+    std::vector<std::string> allowed_comms_{};
+    FlatHashMap<int, Task> tasks_{};
+    FlatHashMap<int, Task> prev_tasks_{};
+    bool has_prev_{false};
+    bool sampled_{false};  // both CPU and thread stats were refreshed
+    double ms_per_tick_{10};
+    std::string iter_start_timestamp_{};
+    uint64_t num_intrusions_{};
+
+    [[nodiscard]] bool IsAllowed(const char *comm) const;
+    void CheckTask(PidStat const& value);
+};
+
+#endif //CPUSTATS_ISOLATION_WATCHDOG_HPP
@@ -1,8 +1,10 @@
 #include "table.hpp"
 #include "../utility/datetime.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fmt/format.h>
+#include <unistd.h>
 #include <date.h>
 
 Table::Table(const Settings &settings)
@@ -13,11 +15,29 @@ Table::Table(const Settings &settings)
     if (settings.show_pid_stats) {
         columns_.push_back({index++, "PID", 8});
     }
-    for (int i{}; i < settings.num_cpus; i++) {
-        columns_.push_back({index++, fmt::format("cpu{}", i), 9});
+    if (settings.show_quota_util) {
+        quota_col_index_ = index;
+        columns_.push_back({index++, "Quota", 18});
+    }
+    std::vector<int> cpus{settings.cpus};
+    if (cpus.empty()) {
+        for (int i{}; i < settings.num_cpus; i++) {
+            cpus.push_back(i);
+        }
+    }
+    for (int cpu: cpus) {
+        if (cpu >= cpu_col_index_.size()) {
+            cpu_col_index_.resize(cpu + 1, -1);
+        }
+        cpu_col_index_[cpu] = index;
+        columns_.push_back({index++, fmt::format("cpu{}", cpu), 9});
     }
     if (settings.show_pid_stats) {
-        columns_.push_back({index++, "Proc.status", 16});
+        columns_.push_back({index++, "Proc.status", settings.top_pids > 0 ? size_t{26} : size_t{16}});
+    }
+    top_tasks_.reserve(settings.top_pids);
+    if (auto ticks = sysconf(_SC_CLK_TCK); ticks > 0) {
+        ticks_per_second_ = static_cast<double>(ticks);
     }
     // Build row
     for (auto const& col: columns_) {
@@ -40,15 +60,31 @@ bool Table::Start() {
     return true;
 }
 
-void Table::BeginIter() {
+void Table::BeginIter(SourceSet refreshed) {
+    if (refreshed.empty()) {
+        // Last iteration of the run, with values managers finish with, has no row
+        return;
+    }
     auto const& col = time_col();
     auto s_val = GetISOCurrentTime<std::chrono::milliseconds>();
     row_[col.index].value = fmt::format(" {:<{}s}", s_val, col.width-1);
     empty_row_ = false;
+    // Task rates are computed over the interval between PID scans
+    if (refreshed.Contains(Source::pids)) {
+        prev_iter_time_ = iter_time_;
+        iter_time_ = GetSteadyCurrentTime();
+        task_cpu_times_.BeginScan();
+    }
 }
 
-void Table::EndIter() {
+void Table::EndIter(SourceSet refreshed) {
+    if (refreshed.empty()) {
+        return;
+    }
     PrintRow();
+    if (settings_.top_pids > 0 && refreshed.Contains(Source::pids)) {
+        PrintTopTasks();
+    }
     if (settings_.show_divider) {
         PrintDivider();
     }
@@ -61,7 +97,7 @@ void Table::Accept(CpuInfo const& value, bool last_in_cycle) {
 }
 
 void Table::Accept(CpuUtil const& value, bool last_in_cycle) {
-    if (!settings_.show_cpu_stats) return;
+    if (!settings_.show_cpu_stats || !has_cpu_col(value.cpu)) return;
     auto const& col = cpu_col(value.cpu);
     std::string s_val;
     if (settings_.normalize_cpu_utility) {
@@ -76,18 +112,147 @@ void Table::Accept(CpuUtil const& value, bool last_in_cycle) {
     }
 }
 
+void Table::Accept(CpuQuotaUtil const& value, bool last_in_cycle) {
+    if (quota_col_index_ < 0) return;
+    auto const& col = columns_.at(quota_col_index_);
+    std::string s_val;
+    if (settings_.normalize_cpu_utility) {
+        s_val = fmt::format("{:>7.5f}/{:.1f}", value.busy_rate, value.limit_cpus);
+    } else {
+        s_val = fmt::format("{:>6.2f}%/{:.1f}", value.busy_rate * 100.0, value.limit_cpus);
+    }
+    row_[col.index].value = fmt::format("{:^{}s}", s_val, col.width);
+    empty_row_ = false;
+}
+
 void Table::Accept(PidStat const& value, bool last_in_cycle) {
+    Accept(std::span<const PidStat>{&value, 1});
+}
+
+void Table::Accept(std::span<const PidStat> values) {
     if (!settings_.show_pid_stats) return;
+    if (settings_.top_pids > 0) {
+        for (auto const& value: values) {
+            AcceptTopCandidate(value);
+        }
+        return;
+    }
+    for (auto const& value: values) {
+        PrintPidRow(value);
+    }
+}
+
+void Table::PrintPidRow(PidStat const& value) {
     auto const& c_pid = pid_col();
     auto const& c_status = pid_status_col();
-    auto const& c_cpu = cpu_col(value.cpu);
     row_[c_pid.index].value = fmt::format("{:^{}d}", value.pid, c_pid.width);
-    row_[c_cpu.index].value = fmt::format("{:^{}c}", 'x', c_cpu.width);
-    row_[c_status.index].value = fmt::format(" {:<{}s}", ToString(value.state), c_status.width-1);
+    // Thread may run on a CPU outside the shown set, e.g. outside container cpuset
+    if (has_cpu_col(value.cpu)) {
+        auto const& c_cpu = cpu_col(value.cpu);
+        row_[c_cpu.index].value = fmt::format("{:^{}c}", 'x', c_cpu.width);
+    }
+    if (value.affinity_violation != AffinityViolation::none) {
+        auto s_status = fmt::format("{} !{}", ToString(value.state),
+                                    value.affinity_violation == AffinityViolation::foreign ? "foreign" : "affinity");
+        row_[c_status.index].value = fmt::format(" {:<{}s}", s_status, c_status.width-1);
+    } else {
+        row_[c_status.index].value = fmt::format(" {:<{}s}", ToString(value.state), c_status.width-1);
+    }
     empty_row_ = false;
     PrintRow();
 }
 
+void Table::Accept(CpuRunQueue const& value, bool last_in_cycle) {
+    // Counts are known after all tasks are scanned, so they are printed
+    // in a separate row below the tasks, in the CPU columns
+    if (!settings_.show_run_queue) return;
+    if (has_cpu_col(value.cpu)) {
+        auto const& col = cpu_col(value.cpu);
+        auto s_val = fmt::format("R{} D{}", value.running, value.waiting);
+        row_[col.index].value = fmt::format("{:^{}s}", s_val, col.width);
+        empty_row_ = false;
+    }
+    if (last_in_cycle && !empty_row_) {
+        auto const& c_time = time_col();
+        row_[c_time.index].value = fmt::format(" {:<{}s}", "run queue", c_time.width-1);
+        PrintRow();
+    }
+}
+
+void Table::Accept(ProcessTreeStat const& value, bool last_in_cycle) {
+    if (!settings_.show_pid_stats) return;
+    auto const& c_pid = pid_col();
+    auto const& c_status = pid_status_col();
+    auto format_rate = [this](double rate) {
+        return settings_.normalize_cpu_utility ? fmt::format("{:.5f}", rate) : fmt::format("{:.2f}%", rate * 100.0);
+    };
+    row_[c_pid.index].value = fmt::format("{:^{}d}", value.root_pid, c_pid.width);
+    for (int cpu: value.cpus) {
+        if (has_cpu_col(cpu)) {
+            auto const& c_cpu = cpu_col(cpu);
+            row_[c_cpu.index].value = fmt::format("{:^{}c}", 'x', c_cpu.width);
+        }
+    }
+    auto s_status = fmt::format("tree {} {}", value.num_processes, format_rate(value.cpu_rate));
+    row_[c_status.index].value = fmt::format(" {:<{}s}", s_status, c_status.width-1);
+    empty_row_ = false;
+    PrintRow();
+    for (auto const& member: value.members) {
+        row_[c_pid.index].value = fmt::format("{:^{}d}", member.pid, c_pid.width);
+        if (has_cpu_col(member.cpu)) {
+            auto const& c_cpu = cpu_col(member.cpu);
+            row_[c_cpu.index].value = fmt::format("{:^{}c}", 'x', c_cpu.width);
+        }
+        auto s_member = fmt::format("ppid {} {}", member.ppid, format_rate(member.cpu_rate));
+        row_[c_status.index].value = fmt::format(" {:<{}s}", s_member, c_status.width-1);
+        empty_row_ = false;
+        PrintRow();
+    }
+}
+
+namespace {
+
+// Min-heap order, the least busy of the top tasks is at the front
+constexpr auto kTopHeapGreater = [](auto const& a, auto const& b) {
+    return a.cpu_time > b.cpu_time;
+};
+
+}
+
+void Table::AcceptTopCandidate(PidStat const& value) {
+    if (value.state == PidStat::State::not_found) return;
+    auto delta = task_cpu_times_.Record(value).cpu_time;
+    if (delta == 0) return;
+    if (top_tasks_.size() == settings_.top_pids) {
+        if (delta <= top_tasks_.front().cpu_time) return;
+        std::pop_heap(top_tasks_.begin(), top_tasks_.end(), kTopHeapGreater);
+        top_tasks_.pop_back();
+    }
+    top_tasks_.push_back({.cpu_time = delta, .pid = value.pid, .cpu = value.cpu, .comm = value.comm});
+    std::push_heap(top_tasks_.begin(), top_tasks_.end(), kTopHeapGreater);
+}
+
+void Table::PrintTopTasks() {
+    std::sort_heap(top_tasks_.begin(), top_tasks_.end(), kTopHeapGreater);
+    auto const& c_pid = pid_col();
+    auto const& c_status = pid_status_col();
+    double elapsed_ticks = std::chrono::duration<double>(iter_time_ - prev_iter_time_).count() * ticks_per_second_;
+    for (auto const& task: top_tasks_) {
+        double rate = elapsed_ticks > 0 ? static_cast<double>(task.cpu_time) / elapsed_ticks : 0.0;
+        row_[c_pid.index].value = fmt::format("{:^{}d}", task.pid, c_pid.width);
+        if (has_cpu_col(task.cpu)) {
+            auto const& c_cpu = cpu_col(task.cpu);
+            row_[c_cpu.index].value = fmt::format("{:^{}c}", 'x', c_cpu.width);
+        }
+        auto s_util = settings_.normalize_cpu_utility ? fmt::format("{:.5f}", rate) : fmt::format("{:.2f}%", rate * 100.0);
+        auto s_status = fmt::format("{:<15s} {:>8s}", task.comm.data(), s_util);
+        row_[c_status.index].value = fmt::format(" {:<{}s}", s_status, c_status.width-1);
+        empty_row_ = false;
+        PrintRow();
+    }
+    top_tasks_.clear();
+}
+
 size_t Table::full_width() const {
     if (full_width_) {
         return *full_width_;
@@ -114,15 +279,19 @@ Table::Col const& Table::pid_col() const {
 }
 
 Table::Col const& Table::cpu_col(int cpu) const {
-    if (settings_.show_cpu_stats) {
-        return columns_.at((settings_.show_pid_stats ? 2 : 1) + cpu);
+    if (settings_.show_cpu_stats && has_cpu_col(cpu)) {
+        return columns_.at(cpu_col_index_[cpu]);
     } else {
         std::cerr << "Unexpected error: requested cpu" << cpu
-                  << " table column while CPU stats disabled\n";
+                  << " table column while CPU stats disabled or CPU not shown\n";
         throw std::runtime_error("bad column");
     }
 }
 
+bool Table::has_cpu_col(int cpu) const {
+    return cpu >= 0 && cpu < cpu_col_index_.size() && cpu_col_index_[cpu] >= 0;
+}
+
 Table::Col const& Table::pid_status_col() const {
     if (settings_.show_pid_stats) {
         return columns_.back();
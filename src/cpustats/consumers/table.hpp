@@ -3,8 +3,12 @@
 
 #include "../managers/cpu_manager.hpp"
 #include "../managers/pid_manager.hpp"
+#include "../managers/process_tree_manager.hpp"
 #include "consumer_base.hpp"
+#include "task_cpu_times.hpp"
 
+#include <array>
+#include <chrono>
 #include <iostream>
 #include <optional>
 
@@ -12,7 +16,10 @@ class Table :
         public Consumer,
         public CpuUtilAcceptor,
         public CpuInfoAcceptor,
-        public PidStatAcceptor {
+        public CpuQuotaUtilAcceptor,
+        public PidStatAcceptor,
+        public CpuRunQueueAcceptor,
+        public ProcessTreeStatAcceptor {
 public:
     struct Col {
         int index;
@@ -33,6 +40,10 @@ public:
         bool show_divider{true};
         bool show_outer_delims{false};
         int num_cpus{};
+        std::vector<int> cpus{};  // if empty, all CPUs from 0 to num_cpus - 1
+        bool show_quota_util{false};
+        bool show_run_queue{false};
+        size_t top_pids{0};  // if not 0, show only this number of busiest tasks
         bool normalize_cpu_utility{false};
     };
 
@@ -41,13 +52,17 @@ public:
     Settings const& settings() const { return settings_; }
 
     bool Start() override;
-    void BeginIter() override;
-    void EndIter() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
     void Finish() override;
 
     void Accept(CpuInfo const& value, bool last_in_cycle = false) override;
     void Accept(CpuUtil const& value, bool last_in_cycle = false) override;
+    void Accept(CpuQuotaUtil const& value, bool last_in_cycle = false) override;
     void Accept(PidStat const& value, bool last_in_cycle = false) override;
+    void Accept(std::span<const PidStat> values) override;
+    void Accept(CpuRunQueue const& value, bool last_in_cycle = false) override;
+    void Accept(ProcessTreeStat const& value, bool last_in_cycle = false) override;
 
     size_t full_width() const;
 
@@ -58,10 +73,34 @@ private:
     std::vector<Cell> row_{};
     mutable std::optional<size_t> full_width_;
     bool empty_row_{};
+    std::vector<int> cpu_col_index_{};  // column index by CPU, -1 if not shown
+    int quota_col_index_{-1};
+
+    /*
+     * Top tasks selection: CPU time of tasks is kept to compute deltas,
+     * the busiest tasks are kept in a bounded min-heap, printed on EndIter()
+     */
+    struct TopTask {
+        unsigned long long cpu_time{};
+        int pid{};
+        int cpu{};
+        std::array<char, PidStat::kCommSize> comm{};
+    };
+
+    TaskCpuTimes<> task_cpu_times_{};
+    std::vector<TopTask> top_tasks_{};
+    std::chrono::steady_clock::time_point iter_time_{};
+    std::chrono::steady_clock::time_point prev_iter_time_{};
+    double ticks_per_second_{100};
+
+    void PrintPidRow(PidStat const& value);
+    void AcceptTopCandidate(PidStat const& value);
+    void PrintTopTasks();
 
     Col const& time_col() const;
     Col const& pid_col() const;
     Col const& cpu_col(int cpu) const;
+    bool has_cpu_col(int cpu) const;
     Col const& pid_status_col() const;
 
     void PrintRow();
@@ -0,0 +1,90 @@
+#ifndef CPUSTATS_TASK_CPU_TIMES_HPP
+#define CPUSTATS_TASK_CPU_TIMES_HPP
+
+#include "../system/linux_proc.hpp"
+#include "../utility/datetime.hpp"
+#include "../utility/flat_hash_map.hpp"
+
+#include <utility>
+#include <variant>
+
+
+/**
+ * CPU time of tasks (utime + stime) between PID scans, for consumers
+ * that rank or aggregate tasks by it.
+ *
+ * Tasks of the current scan are recorded in one flat hash map while
+ * those of the previous scan are looked up in another, then the maps
+ * are swapped, so exited tasks are dropped without erasing them one by
+ * one.
+ *
+ * A task missing from the previous scan is charged with all its CPU
+ * time only if it started after that scan. Other such tasks (after a
+ * transient read failure, threads newly matching --comm or --cgroup,
+ * PIDs added over the control socket) only get a baseline, as their
+ * lifetime CPU time does not belong to a single interval.
+ *
+ * @tparam Data kept per task along with its CPU time, e.g. a cached key
+ */
+template<typename Data = std::monostate>
+class TaskCpuTimes {
+public:
+    struct Task {
+        unsigned long long starttime{};
+        unsigned long long cpu_time{};
+        Data data{};
+    };
+
+    struct Delta {
+        Task *task{};                   // nullptr if the task was already recorded in this scan
+        Task const *prev{};             // the task in the previous scan, if it was there
+        unsigned long long cpu_time{};  // since the previous scan, in clock ticks
+    };
+
+    /** Start a scan, tasks recorded so far become the previous ones */
+    void BeginScan() {
+        if (scanning_) {
+            std::swap(tasks_, prev_tasks_);
+            tasks_.Clear();
+            prev_scan_time_ = scan_time_;
+            has_prev_ = true;
+        }
+        scan_time_ = GetClockTicksSinceBoot();
+        scanning_ = true;
+    }
+
+    /** Whether the current scan has a previous one to compute deltas from */
+    [[nodiscard]] bool has_prev() const { return has_prev_; }
+
+    /** Record the task in the current scan, its `data` is left to the caller */
+    Delta Record(PidStat const& stat) {
+        auto [task, inserted] = tasks_.TryEmplace(stat.pid);
+        if (!inserted) {
+            return {};
+        }
+        auto cpu_time = stat.utime + stat.stime;
+        task->starttime = stat.starttime;
+        task->cpu_time = cpu_time;
+        Delta delta{.task = task, .prev = prev_tasks_.Find(stat.pid), .cpu_time = 0};
+        if (delta.prev && delta.prev->starttime != stat.starttime) {
+            delta.prev = nullptr;  // PID was reused
+        }
+        if (delta.prev) {
+            delta.cpu_time = cpu_time >= delta.prev->cpu_time ? cpu_time - delta.prev->cpu_time : 0;
+        } else if (has_prev_ && stat.starttime > prev_scan_time_) {
+            // Task started during the interval has all its CPU time in it
+            delta.cpu_time = cpu_time;
+        }
+        return delta;
+    }
+
+private:
+    FlatHashMap<int, Task> tasks_{1024};
+    FlatHashMap<int, Task> prev_tasks_{1024};
+    bool scanning_{false};
+    bool has_prev_{false};
+    unsigned long long scan_time_{};  // in clock ticks since boot, as task start times
+    unsigned long long prev_scan_time_{};
+};
+
+#endif //CPUSTATS_TASK_CPU_TIMES_HPP
@@ -0,0 +1,137 @@
+#include "task_groups.hpp"
+#include "../utility/datetime.hpp"
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+
+GroupByUid::Key GroupByUid::GetKey(PidStat const& stat) {
+    // Tasks that exited right after their stat was read fall into a
+    // group with an invalid UID
+    return ReadProcPidUid(stat.pid).value_or(static_cast<unsigned>(-1));
+}
+
+void GroupByUid::Write(std::ostream& os, Key const& key) {
+    os << key;
+}
+
+size_t GroupByComm::Hash::operator()(Key const& key) const {
+    // FNV-1a over the name up to the terminating NUL
+    uint64_t hash = 14695981039346656037ull;
+    for (char c: key) {
+        if (!c) break;
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void GroupByComm::Write(std::ostream& os, Key const& key) {
+    os.write(key.data(), static_cast<std::streamsize>(strnlen(key.data(), key.size())));
+}
+
+
+template<typename GroupBy>
+TaskGroupCsvWriter<GroupBy>::TaskGroupCsvWriter() {
+    if (auto ticks = sysconf(_SC_CLK_TCK); ticks > 0) {
+        ticks_per_second_ = static_cast<double>(ticks);
+    }
+}
+
+template<typename GroupBy>
+bool TaskGroupCsvWriter<GroupBy>::Start() {
+    if (is_header_enabled()) {
+        stream() << "timestamp"
+            << delim() << GroupBy::kName
+            << delim() << "tasks"
+            << delim() << "cpu_util"
+            << std::endl;
+    }
+    return true;
+}
+
+template<typename GroupBy>
+void TaskGroupCsvWriter<GroupBy>::BeginIter(SourceSet refreshed) {
+    if (!refreshed.Contains(Source::pids)) {
+        return;
+    }
+    iter_start_timestamp_ = GetISOCurrentTime<std::chrono::milliseconds>();
+    prev_iter_time_ = iter_time_;
+    iter_time_ = GetSteadyCurrentTime();
+    task_cpu_times_.BeginScan();
+}
+
+template<typename GroupBy>
+void TaskGroupCsvWriter<GroupBy>::EndIter(SourceSet refreshed) {
+    if (!refreshed.Contains(Source::pids)) {
+        return;
+    }
+    if (task_cpu_times_.has_prev()) {
+        top_groups_.clear();
+        groups_.ForEach([this](Key const& key, Group const& group) {
+            top_groups_.emplace_back(key, group);
+        });
+        auto by_cpu_time = [](auto const& a, auto const& b) {
+            return a.second.cpu_time > b.second.cpu_time;
+        };
+        auto num_rows = top_ > 0 ? std::min(top_, top_groups_.size()) : top_groups_.size();
+        std::partial_sort(top_groups_.begin(), top_groups_.begin() + num_rows, top_groups_.end(), by_cpu_time);
+
+        double elapsed_ticks = std::chrono::duration<double>(iter_time_ - prev_iter_time_).count() * ticks_per_second_;
+        std::stringstream ss;
+        for (size_t i{}; i < num_rows; i++) {
+            auto const& [key, group] = top_groups_[i];
+            double rate = elapsed_ticks > 0 ? static_cast<double>(group.cpu_time) / elapsed_ticks : 0.0;
+            ss << iter_start_timestamp_ << delim();
+            GroupBy::Write(ss, key);
+            ss << delim() << group.num_tasks << delim()
+                << (normalize_cpu_utility_ ? fmt::format("{:.5f}", rate) : fmt::format("{:.2f}", rate * 100))
+                << '\n';
+        }
+        stream() << ss.str();
+        stream().flush();
+    }
+    groups_.Clear();
+}
+
+template<typename GroupBy>
+void TaskGroupCsvWriter<GroupBy>::Finish() {}
+
+template<typename GroupBy>
+void TaskGroupCsvWriter<GroupBy>::Accept(PidStat const& value, bool _) {
+    Accept(std::span<const PidStat>{&value, 1});
+}
+
+template<typename GroupBy>
+void TaskGroupCsvWriter<GroupBy>::Accept(std::span<const PidStat> values) {
+    for (auto const& value: values) {
+        AddTask(value);
+    }
+}
+
+template<typename GroupBy>
+void TaskGroupCsvWriter<GroupBy>::AddTask(PidStat const& value) {
+    if (value.state == PidStat::State::not_found) {
+        return;
+    }
+    auto delta = task_cpu_times_.Record(value);
+    if (!delta.task) {
+        return;  // same task reported twice
+    }
+    auto& key = delta.task->data;
+    if constexpr (GroupBy::kCacheKey) {
+        key = delta.prev ? delta.prev->data : GroupBy::GetKey(value);
+    } else {
+        key = GroupBy::GetKey(value);
+    }
+
+    auto [group, _inserted] = groups_.TryEmplace(key);
+    group->cpu_time += delta.cpu_time;
+    group->num_tasks++;
+}
+
+template class TaskGroupCsvWriter<GroupByUid>;
+template class TaskGroupCsvWriter<GroupByComm>;
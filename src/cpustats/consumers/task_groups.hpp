@@ -0,0 +1,96 @@
+#ifndef CPUSTATS_TASK_GROUPS_HPP
+#define CPUSTATS_TASK_GROUPS_HPP
+
+#include "consumer_base.hpp"
+#include "csv_output.hpp"
+#include "task_cpu_times.hpp"
+#include "../managers/pid_manager.hpp"
+#include "../utility/flat_hash_map.hpp"
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+
+/** Groups tasks by the effective user ID, the owner of `/proc/<pid>` */
+struct GroupByUid {
+    using Key = unsigned;
+    static constexpr const char *kName = "uid";
+    static constexpr bool kCacheKey = true;  // read once per task, not per tick
+
+    using Hash = std::hash<Key>;
+
+    static Key GetKey(PidStat const& stat);
+    static void Write(std::ostream& os, Key const& key);
+};
+
+/** Groups tasks by the command name */
+struct GroupByComm {
+    using Key = std::array<char, PidStat::kCommSize>;
+    static constexpr const char *kName = "comm";
+    static constexpr bool kCacheKey = false;  // comm changes on exec
+
+    struct Hash {
+        size_t operator()(Key const& key) const;
+    };
+
+    static Key GetKey(PidStat const& stat) { return stat.comm; }
+    static void Write(std::ostream& os, Key const& key);
+};
+
+
+/**
+ * Aggregates CPU time of tasks by group (user or command name) and
+ * writes the busiest groups on every iteration.
+ *
+ * Groups are updated as PID stats arrive, so no per-tick list of tasks
+ * is built. The only per-task state is the previous CPU time, needed
+ * to compute deltas, kept by TaskCpuTimes. Both per-task and per-group
+ * tables are flat hash maps, cleared in O(1) and reused across
+ * iterations.
+ */
+template<typename GroupBy>
+class TaskGroupCsvWriter : public CsvWriterBase, public Consumer, public PidStatAcceptor {
+public:
+    using Key = typename GroupBy::Key;
+
+    TaskGroupCsvWriter();
+
+    /** Number of busiest groups written per iteration, 0 to write all */
+    void set_top(size_t top) { top_ = top; }
+    void set_normalize_cpu_utility(bool enabled) { normalize_cpu_utility_ = enabled; }
+
+    bool Start() override;
+    void BeginIter(SourceSet refreshed) override;
+    void EndIter(SourceSet refreshed) override;
+    void Finish() override;
+
+    void Accept(PidStat const& value, bool last_in_cycle = false) override;
+    void Accept(std::span<const PidStat> values) override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Group {
+        unsigned long long cpu_time{};
+        int num_tasks{};
+    };
+
+    size_t top_{10};
+    bool normalize_cpu_utility_{false};
+    double ticks_per_second_{100};
+    TaskCpuTimes<Key> task_cpu_times_{};  // group key cached per task
+    FlatHashMap<Key, Group, typename GroupBy::Hash> groups_{};
+    std::vector<std::pair<Key, Group>> top_groups_{};
+    Clock::time_point iter_time_{};
+    Clock::time_point prev_iter_time_{};
+    std::string iter_start_timestamp_{};
+
+    void AddTask(PidStat const& value);
+};
+
+using UidGroupCsvWriter = TaskGroupCsvWriter<GroupByUid>;
+using CommGroupCsvWriter = TaskGroupCsvWriter<GroupByComm>;
+
+#endif //CPUSTATS_TASK_GROUPS_HPP
@@ -0,0 +1,195 @@
+#include "cgroup_manager.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+
+CgroupManager::~CgroupManager() {
+    Finish();
+}
+
+void CgroupManager::Init() {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        std::cerr << "inotify is not available, new cgroups will not be tracked: "
+                  << std::strerror(errno) << "\n";
+    }
+    AddTree(root_);
+    if (cgroups_.empty()) {
+        std::cerr << "No cgroups with cpu.stat found under " << root_ << "\n";
+    }
+    prev_time_ = std::chrono::steady_clock::now();
+}
+
+void CgroupManager::Sample() {
+    ProcessEvents();
+    n_valid_ = 0;
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration<double, std::micro>(now - prev_time_).count();
+    prev_time_ = now;
+    if (elapsed_us <= 0) {
+        return;
+    }
+
+    // Read all cpu.stat files in one batch before calling acceptors
+    char buf[512];
+    for (auto& [path, cgroup]: cgroups_) {
+        cgroup.valid = false;
+        if (!cgroup.populated) {
+            continue;
+        }
+        CgroupCpuStatValues curr{};
+        if (cgroup.cpu_stat.Read(buf, sizeof(buf)) <= 0 || !ParseCgroupCpuStat(buf, curr)) {
+            continue;
+        }
+        auto& stat = cgroup.stat;
+        auto const& prev = cgroup.prev;
+        stat.usage_rate = static_cast<double>(curr.usage_usec - prev.usage_usec) / elapsed_us;
+        stat.user_rate = static_cast<double>(curr.user_usec - prev.user_usec) / elapsed_us;
+        stat.system_rate = static_cast<double>(curr.system_usec - prev.system_usec) / elapsed_us;
+        stat.nr_periods = curr.nr_periods - prev.nr_periods;
+        stat.nr_throttled = curr.nr_throttled - prev.nr_throttled;
+        stat.throttled_usec = curr.throttled_usec - prev.throttled_usec;
+        cgroup.prev = curr;
+        cgroup.valid = true;
+        n_valid_++;
+    }
+}
+
+void CgroupManager::Publish() {
+    // Nothing was read if Sample() returned early, flags are stale then
+    auto n_valid = n_valid_;
+    if (n_valid == 0) {
+        return;
+    }
+    for (auto const& [path, cgroup]: cgroups_) {
+        if (!cgroup.valid) continue;
+        bool last_in_iter = --n_valid == 0;
+        for (auto const& acceptor: acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(cgroup.stat, last_in_iter);
+        }
+    }
+}
+
+void CgroupManager::Finish() {
+    if (inotify_fd_ >= 0) {
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+    }
+    watches_.clear();
+    cgroups_.clear();
+}
+
+void CgroupManager::AddTree(std::string const& root) {
+    for (auto const& path: ListCgroupTree(root)) {
+        AddCgroup(path);
+    }
+}
+
+void CgroupManager::AddCgroup(std::string const& path) {
+    if (cgroups_.contains(path)) {
+        return;
+    }
+    Cgroup cgroup{};
+    if (!cgroup.cpu_stat.Open(path + "/cpu.stat")) {
+        return;
+    }
+    char buf[512];
+    if (cgroup.cpu_stat.Read(buf, sizeof(buf)) <= 0 || !ParseCgroupCpuStat(buf, cgroup.prev)) {
+        return;
+    }
+    cgroup.stat.path = path;
+    // The root cgroup has no cgroup.events and is always populated
+    if (cgroup.events.Open(path + "/cgroup.events")) {
+        ReadPopulated(cgroup);
+    }
+    if (inotify_fd_ >= 0) {
+        cgroup.dir_wd = inotify_add_watch(inotify_fd_, path.c_str(), IN_CREATE | IN_DELETE_SELF | IN_ONLYDIR);
+        if (cgroup.dir_wd >= 0) {
+            watches_[cgroup.dir_wd] = path;
+        }
+        if (cgroup.events.is_open()) {
+            cgroup.events_wd = inotify_add_watch(inotify_fd_, cgroup.events.path().c_str(), IN_MODIFY);
+            if (cgroup.events_wd >= 0) {
+                watches_[cgroup.events_wd] = path;
+            }
+        }
+    }
+    cgroups_.emplace(path, std::move(cgroup));
+}
+
+void CgroupManager::RemoveCgroup(std::string const& path) {
+    auto it = cgroups_.find(path);
+    if (it == cgroups_.end()) {
+        return;
+    }
+    // Watches are released by the kernel when the directory is removed,
+    // IN_IGNORED events for them will be skipped since the path is unknown.
+    for (int wd: {it->second.dir_wd, it->second.events_wd}) {
+        if (wd >= 0) {
+            watches_.erase(wd);
+        }
+    }
+    cgroups_.erase(it);
+}
+
+void CgroupManager::ProcessEvents() {
+    if (inotify_fd_ < 0) {
+        return;
+    }
+    alignas(inotify_event) char buf[4096];
+    bool overflow{false};
+    while (true) {
+        auto len = read(inotify_fd_, buf, sizeof(buf));
+        if (len <= 0) {
+            break;
+        }
+        for (char *ptr{buf}; ptr < buf + len; ) {
+            auto const *event = reinterpret_cast<inotify_event const *>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            auto watch_it = watches_.find(event->wd);
+            if (watch_it == watches_.end()) {
+                continue;
+            }
+            auto path = watch_it->second;
+            if ((event->mask & IN_CREATE) && (event->mask & IN_ISDIR)) {
+                AddTree(path + "/" + event->name);
+            } else if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+                RemoveCgroup(path);
+            } else if (event->mask & IN_MODIFY) {
+                if (auto it = cgroups_.find(path); it != cgroups_.end()) {
+                    ReadPopulated(it->second);
+                }
+            }
+        }
+    }
+    if (overflow) {
+        // Some creations were missed, the only way to find them is to rewalk
+        AddTree(root_);
+    }
+}
+
+void CgroupManager::ReadPopulated(Cgroup& cgroup) {
+    char buf[128];
+    if (cgroup.events.Read(buf, sizeof(buf)) > 0) {
+        bool populated = ParseCgroupPopulated(buf);
+        if (populated && !cgroup.populated) {
+            // Counters were not followed while the cgroup was empty
+            char stat_buf[512];
+            if (cgroup.cpu_stat.Read(stat_buf, sizeof(stat_buf)) > 0) {
+                ParseCgroupCpuStat(stat_buf, cgroup.prev);
+            }
+        }
+        cgroup.populated = populated;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef CPUSTATS_CGROUP_MANAGER_HPP
+#define CPUSTATS_CGROUP_MANAGER_HPP
+
+#include "manager_base.hpp"
+#include "../system/linux_cgroup.hpp"
+#include "../system/persistent_file.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * CPU usage and throttling of a cgroup during the last interval.
+ * Rates are in CPUs (1.0 = one CPU fully busy), counters are deltas.
+ */
+struct CgroupCpuStat {
+    std::string path{};
+    double usage_rate{};
+    double user_rate{};
+    double system_rate{};
+    uint64_t nr_periods{};
+    uint64_t nr_throttled{};
+    uint64_t throttled_usec{};
+};
+
+class CgroupCpuStatAcceptor : public virtual Acceptor {
+public:
+    virtual ~CgroupCpuStatAcceptor() = default;
+    virtual void Accept(CgroupCpuStat const& value, bool last_in_iter = false) = 0;
+};
+
+
+/**
+ * Records `cpu.stat` of every cgroup in a cgroup v2 subtree.
+ *
+ * The subtree is walked once in `Init()`. After that, cgroups creation
+ * and removal is tracked with inotify on cgroup directories, and
+ * `cgroup.events` is watched to skip cgroups without processes.
+ */
+class CgroupManager : public Manager {
+public:
+    ~CgroupManager();
+
+    void Init() override;
+    void Sample() override;
+    void Publish() override;
+    void Finish() override;
+    [[nodiscard]] Source source() const override { return Source::cgroups; }
+
+    void add_acceptor(std::shared_ptr<CgroupCpuStatAcceptor> acceptor) {
+        acceptors_.push_back(std::move(acceptor));
+    }
+
+    void set_root(std::string root) { root_ = std::move(root); }
+    [[nodiscard]] std::string const& root() const { return root_; }
+
+private:
+    struct Cgroup {
+        PersistentFile cpu_stat{};
+        PersistentFile events{};
+        int dir_wd{-1};
+        int events_wd{-1};
+        bool populated{true};
+        bool valid{false};
+        CgroupCpuStatValues prev{};
+        CgroupCpuStat stat{};
+    };
+
+    std::vector<std::shared_ptr<CgroupCpuStatAcceptor>> acceptors_{};
+    std::string root_{"/sys/fs/cgroup"};
+    std::map<std::string, Cgroup> cgroups_{};
+    std::unordered_map<int, std::string> watches_{};
+    std::chrono::steady_clock::time_point prev_time_{};
+    size_t n_valid_{};  // cgroups read by the last Sample()
+    int inotify_fd_{-1};
+
+    void AddTree(std::string const& root);
+    void AddCgroup(std::string const& path);
+    void RemoveCgroup(std::string const& path);
+    void ProcessEvents();
+    static void ReadPopulated(Cgroup& cgroup);
+};
+
+#endif //CPUSTATS_CGROUP_MANAGER_HPP
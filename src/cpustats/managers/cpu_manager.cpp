@@ -1,12 +1,29 @@
 #include "cpu_manager.hpp"
+#include "../system/linux_cgroup.hpp"
 #include "../utility/strings.hpp"
+#include <algorithm>
 #include <numeric>
 #include <cassert>
 #include <cstring>
 
 
+void CpuManager::set_cgroup(std::string const& path, double limit_cpus) {
+    if (!cgroup_cpu_stat_.Open(path + "/cpu.stat")) {
+        std::cerr << "Error opening " << path << "/cpu.stat, "
+                     "usage relative to CPU quota will not be recorded\n";
+        return;
+    }
+    cgroup_limit_cpus_ = limit_cpus;
+}
+
+
 void CpuManager::Init() {
     cpu_info_list_ = LoadProcCpuInfo();
+    if (!cpus_.empty()) {
+        std::erase_if(cpu_info_list_, [this](CpuInfo const& info) {
+            return !std::binary_search(cpus_.begin(), cpus_.end(), info.cpu);
+        });
+    }
     auto n_cpus = cpu_info_list_.size();
     cpu_stat_list_1_.resize(n_cpus);
     cpu_stat_list_2_.resize(n_cpus);
@@ -22,35 +39,90 @@ void CpuManager::Init() {
 
     // Inform CPU-Stat consumers about current stats (also during updates)
     CallAcceptors(cpu_stat_acceptors_, curr_cpu_stat_list_->begin(), curr_cpu_stat_list_->end());
+
+    if (cgroup_cpu_stat_.is_open()) {
+        prev_cgroup_usage_usec_ = ReadCgroupUsage().value_or(0);
+        prev_cgroup_time_ = std::chrono::steady_clock::now();
+    }
 }
 
 
-void CpuManager::Update() {
+void CpuManager::Sample() {
     std::swap(curr_cpu_stat_list_, prev_cpu_stat_list_);
     ReadProcStat(*curr_cpu_stat_list_);
-    CallAcceptors(cpu_stat_acceptors_, curr_cpu_stat_list_->begin(), curr_cpu_stat_list_->end());
 
-    std::vector<CpuUtil> cpu_util_list{};
-    cpu_util_list.resize(cpu_info_list_.size());
+    auto& cpu_util_list = cpu_util_list_;
+    cpu_util_list.clear();
 
     for (size_t i{}; i < cpu_info_list_.size(); i++) {
-        auto const& curr = curr_cpu_stat_list_->at(i);
+        auto& curr = curr_cpu_stat_list_->at(i);
         auto const& prev = prev_cpu_stat_list_->at(i);
         assert(curr.cpu == prev.cpu);
         CpuStat diff{};
         Subtract(curr.values, prev.values, diff.values);
 
-        auto& cpu_util = cpu_util_list[i];
-        cpu_util.cpu = curr.cpu;
         int total = std::accumulate(diff.values.begin(), diff.values.end(), 0);
+        if (total == 0) {
+            // Interval shorter than a clock tick: no utilization for the CPU, and the
+            // previous values are kept so the next interval covers the whole tick
+            curr.values = prev.values;
+            continue;
+        }
+        auto& cpu_util = cpu_util_list.emplace_back();
+        cpu_util.cpu = curr.cpu;
         int not_idle = total - *diff.idle();
         cpu_util.busy_rate = static_cast<double>(not_idle) / total;
         cpu_util.idle_rate = static_cast<double>(*diff.idle()) / total;
     }
 
-    CallAcceptors(cpu_util_acceptors_, cpu_util_list.begin(), cpu_util_list.end());
+    if (cgroup_cpu_stat_.is_open()) {
+        UpdateCgroup();
+    }
+}
+
+void CpuManager::Publish() {
+    CallAcceptors(cpu_stat_acceptors_, curr_cpu_stat_list_->begin(), curr_cpu_stat_list_->end());
+    // Quota utilization goes first, since CPU utilization completes the row
+    if (cpu_quota_util_) {
+        for (auto const& acceptor: cpu_quota_util_acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(*cpu_quota_util_, true);
+        }
+    }
+    for (auto const& acceptor: cpu_util_acceptors_) {
+        if (!acceptor->is_enabled()) continue;
+        acceptor->Accept(std::span<const CpuUtil>{cpu_util_list_});
+    }
 }
 
 
 void CpuManager::Finish() {
 }
+
+
+std::optional<uint64_t> CpuManager::ReadCgroupUsage() const {
+    char buf[512];
+    CgroupCpuStatValues values{};
+    if (cgroup_cpu_stat_.Read(buf, sizeof(buf)) <= 0 || !ParseCgroupCpuStat(buf, values)) {
+        return std::nullopt;
+    }
+    return values.usage_usec;
+}
+
+
+void CpuManager::UpdateCgroup() {
+    cpu_quota_util_.reset();
+    auto usage_usec = ReadCgroupUsage();
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration<double, std::micro>(now - prev_cgroup_time_).count();
+    if (!usage_usec || elapsed_us <= 0) {
+        return;
+    }
+    CpuQuotaUtil util{};
+    util.used_cpus = static_cast<double>(*usage_usec - prev_cgroup_usage_usec_) / elapsed_us;
+    util.limit_cpus = cgroup_limit_cpus_;
+    util.busy_rate = cgroup_limit_cpus_ > 0 ? util.used_cpus / cgroup_limit_cpus_ : 0;
+    prev_cgroup_usage_usec_ = *usage_usec;
+    prev_cgroup_time_ = now;
+    cpu_quota_util_ = util;
+}
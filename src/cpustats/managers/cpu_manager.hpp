@@ -2,22 +2,27 @@
 #define CPUSTATS_CPU_MANAGER_HPP
 
 #include <array>
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
 #include <iostream>
+#include <optional>
+#include <span>
 
 #include "manager_base.hpp"
 #include "../system/linux_proc.hpp"
+#include "../system/persistent_file.hpp"
 
 
-class CpuStatAcceptor {
+class CpuStatAcceptor : public virtual Acceptor {
 public:
     virtual ~CpuStatAcceptor() = default;
     virtual void Accept(CpuStat const& value, bool last_in_iter = false) = 0;
 };
 
-class CpuInfoAcceptor {
+class CpuInfoAcceptor : public virtual Acceptor {
 public:
     virtual ~CpuInfoAcceptor() = default;
     virtual void Accept(CpuInfo const& value, bool last_in_iter = false) = 0;
@@ -29,18 +34,53 @@ struct CpuUtil {
     double idle_rate;
 };
 
-class CpuUtilAcceptor {
+class CpuUtilAcceptor : public virtual Acceptor {
 public:
     virtual ~CpuUtilAcceptor() = default;
     virtual void Accept(CpuUtil const& value, bool last_in_iter) = 0;
+
+    /**
+     * All CPUs of a tick at once, a view into the manager's buffer valid
+     * during the call. By default passed on one by one.
+     */
+    virtual void Accept(std::span<const CpuUtil> values) {
+        for (size_t i{}; i < values.size(); i++) {
+            Accept(values[i], i + 1 == values.size());
+        }
+    }
+};
+
+/**
+ * CPU usage of the cgroup cpustats runs in, relative to its limit:
+ * the `cpu.max` quota or the size of the effective cpuset, whichever
+ * is smaller.
+ */
+struct CpuQuotaUtil {
+    double used_cpus;
+    double limit_cpus;
+    double busy_rate;
+};
+
+class CpuQuotaUtilAcceptor : public virtual Acceptor {
+public:
+    virtual ~CpuQuotaUtilAcceptor() = default;
+    virtual void Accept(CpuQuotaUtil const& value, bool last_in_iter) = 0;
 };
 
 
 class CpuManager : public Manager {
 public:
+    /** Restrict sampled CPUs to the given list (e.g., container cpuset) */
+    void set_cpus(std::vector<int> cpus) { cpus_ = std::move(cpus); }
+
+    /** Record usage of the cgroup (from `<path>/cpu.stat`) relative to the limit */
+    void set_cgroup(std::string const& path, double limit_cpus);
+
     void Init() override;
-    void Update() override;
+    void Sample() override;
+    void Publish() override;
     void Finish() override;
+    [[nodiscard]] Source source() const override { return Source::cpu; }
 
     void add_acceptor(std::shared_ptr<CpuStatAcceptor> const& acceptor) {
         cpu_stat_acceptors_.push_back(acceptor);
@@ -53,10 +93,23 @@ public:
     void add_acceptor(std::shared_ptr<CpuUtilAcceptor> const& acceptor) {
         cpu_util_acceptors_.push_back(acceptor);
     }
+
+    void add_acceptor(std::shared_ptr<CpuQuotaUtilAcceptor> const& acceptor) {
+        cpu_quota_util_acceptors_.push_back(acceptor);
+    }
 private:
+    std::vector<int> cpus_{};
+    std::vector<std::shared_ptr<CpuQuotaUtilAcceptor>> cpu_quota_util_acceptors_{};
+    PersistentFile cgroup_cpu_stat_{};
+    double cgroup_limit_cpus_{};
+    uint64_t prev_cgroup_usage_usec_{};
+    std::chrono::steady_clock::time_point prev_cgroup_time_{};
+    std::optional<CpuQuotaUtil> cpu_quota_util_{};  // of the last Sample()
+
     std::vector<std::shared_ptr<CpuStatAcceptor>> cpu_stat_acceptors_{};
     std::vector<std::shared_ptr<CpuInfoAcceptor>> cpu_info_acceptors_{};
     std::vector<std::shared_ptr<CpuUtilAcceptor>> cpu_util_acceptors_{};
+    std::vector<CpuUtil> cpu_util_list_{};  // of the last Sample(), CPUs a clock tick elapsed on
     std::vector<CpuInfo> cpu_info_list_{};
     std::vector<CpuStat> cpu_stat_list_1_{};
     std::vector<CpuStat> cpu_stat_list_2_{};
@@ -69,11 +122,15 @@ private:
             auto next_it = it + 1;
             bool last_in_cycle = next_it == end;
             for (auto& acceptor: acceptors) {
+                if (!acceptor->is_enabled()) continue;
                 acceptor->Accept(*it, last_in_cycle);
             }
             it = next_it;
         }
     }
+
+    std::optional<uint64_t> ReadCgroupUsage() const;
+    void UpdateCgroup();
 };
 
 
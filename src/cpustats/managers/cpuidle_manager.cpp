@@ -0,0 +1,104 @@
+#include "cpuidle_manager.hpp"
+#include "../system/linux_proc.hpp"
+#include "../system/proc_root.hpp"
+
+#include <iostream>
+
+
+void CpuIdleManager::Init() {
+    auto cpu_info_list = LoadProcCpuInfo();
+    std::vector<CpuIdleStateInfo> states_list{};
+    for (auto const& cpu_info: cpu_info_list) {
+        auto states = LoadCpuIdleStates(cpu_info.cpu);
+        if (states.empty()) {
+            continue;
+        }
+        auto& files = cpus_.emplace_back();
+        files.cpu = cpu_info.cpu;
+        for (auto const& state: states) {
+            auto dir = CpuIdleStatePath(state.cpu, state.state);
+            files.time.emplace_back().OpenAt(ProcRoot::Instance().sys_fd(), dir + "/time");
+            files.usage.emplace_back().OpenAt(ProcRoot::Instance().sys_fd(), dir + "/usage");
+            states_list.push_back(state);
+        }
+        files.curr_time_us.resize(states.size());
+        files.curr_usage.resize(states.size());
+        files.prev_time_us.resize(states.size());
+        files.prev_usage.resize(states.size());
+        ReadCounters(files, files.prev_time_us, files.prev_usage);
+
+        auto& residency = residency_list_.emplace_back();
+        residency.cpu = cpu_info.cpu;
+        residency.residency.resize(states.size());
+        residency.entry_rate.resize(states.size());
+    }
+    prev_time_ = std::chrono::steady_clock::now();
+
+    if (cpus_.empty()) {
+        std::cerr << "cpuidle is not available, C-state residency "
+                     "will not be recorded\n";
+    }
+
+    for (size_t i{}; i < states_list.size(); i++) {
+        bool last_in_iter = i + 1 == states_list.size();
+        for (auto const& acceptor: state_info_acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(states_list[i], last_in_iter);
+        }
+    }
+}
+
+
+void CpuIdleManager::Sample() {
+    sampled_ = false;
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration<double, std::micro>(now - prev_time_).count();
+    prev_time_ = now;
+    if (elapsed_us <= 0) {
+        return;
+    }
+
+    for (size_t i{}; i < cpus_.size(); i++) {
+        auto& files = cpus_[i];
+        auto& residency = residency_list_[i];
+        ReadCounters(files, files.curr_time_us, files.curr_usage);
+        for (size_t k{}; k < files.curr_time_us.size(); k++) {
+            residency.residency[k] = static_cast<double>(files.curr_time_us[k] - files.prev_time_us[k]) / elapsed_us;
+            residency.entry_rate[k] = static_cast<double>(files.curr_usage[k] - files.prev_usage[k]) * 1e6 / elapsed_us;
+        }
+        // Buffers sized in Init() are swapped, not reallocated
+        files.prev_time_us.swap(files.curr_time_us);
+        files.prev_usage.swap(files.curr_usage);
+    }
+    sampled_ = true;
+}
+
+void CpuIdleManager::Publish() {
+    if (!sampled_) {
+        return;
+    }
+    for (size_t i{}; i < residency_list_.size(); i++) {
+        bool last_in_iter = i + 1 == residency_list_.size();
+        for (auto const& acceptor: residency_acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(residency_list_[i], last_in_iter);
+        }
+    }
+}
+
+
+void CpuIdleManager::Finish() {
+}
+
+
+void CpuIdleManager::ReadCounters(
+        CpuFiles& files,
+        std::vector<uint64_t>& time_us,
+        std::vector<uint64_t>& usage
+) {
+    for (size_t k{}; k < files.time.size(); k++) {
+        // Keep the previous value if the read fails, so the delta is zero
+        time_us[k] = files.time[k].ReadUInt64().value_or(files.prev_time_us[k]);
+        usage[k] = files.usage[k].ReadUInt64().value_or(files.prev_usage[k]);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef CPUSTATS_CPUIDLE_MANAGER_HPP
+#define CPUSTATS_CPUIDLE_MANAGER_HPP
+
+#include "manager_base.hpp"
+#include "../system/linux_sysfs.hpp"
+#include "../system/persistent_file.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+class CpuIdleStateInfoAcceptor : public virtual Acceptor {
+public:
+    virtual ~CpuIdleStateInfoAcceptor() = default;
+    virtual void Accept(CpuIdleStateInfo const& value, bool last_in_iter = false) = 0;
+};
+
+/**
+ * Idle states residency of a single CPU during the last interval.
+ * Both vectors are indexed by the idle state number.
+ */
+struct CpuIdleResidency {
+    int cpu{};
+    std::vector<double> residency{};   // fraction of interval spent in state
+    std::vector<double> entry_rate{};  // number of state entries per second
+};
+
+class CpuIdleResidencyAcceptor : public virtual Acceptor {
+public:
+    virtual ~CpuIdleResidencyAcceptor() = default;
+    virtual void Accept(CpuIdleResidency const& value, bool last_in_iter = false) = 0;
+};
+
+
+/**
+ * Reads `time` and `usage` counters of all cpuidle states of all CPUs
+ * through persistent file descriptors and reports per-interval residency,
+ * one record per CPU.
+ */
+class CpuIdleManager : public Manager {
+public:
+    void Init() override;
+    void Sample() override;
+    void Publish() override;
+    void Finish() override;
+    [[nodiscard]] Source source() const override { return Source::cpuidle; }
+
+    void add_acceptor(std::shared_ptr<CpuIdleStateInfoAcceptor> const& acceptor) {
+        state_info_acceptors_.push_back(acceptor);
+    }
+
+    void add_acceptor(std::shared_ptr<CpuIdleResidencyAcceptor> const& acceptor) {
+        residency_acceptors_.push_back(acceptor);
+    }
+
+private:
+    struct CpuFiles {
+        int cpu{};
+        std::vector<PersistentFile> time{};
+        std::vector<PersistentFile> usage{};
+        std::vector<uint64_t> curr_time_us{};  // Sample() reads into these, then swaps them with prev_*
+        std::vector<uint64_t> curr_usage{};
+        std::vector<uint64_t> prev_time_us{};
+        std::vector<uint64_t> prev_usage{};
+    };
+
+    std::vector<std::shared_ptr<CpuIdleStateInfoAcceptor>> state_info_acceptors_{};
+    std::vector<std::shared_ptr<CpuIdleResidencyAcceptor>> residency_acceptors_{};
+    std::vector<CpuFiles> cpus_{};
+    std::vector<CpuIdleResidency> residency_list_{};
+    std::chrono::steady_clock::time_point prev_time_{};
+    bool sampled_{false};
+
+    static void ReadCounters(CpuFiles& files, std::vector<uint64_t>& time_us, std::vector<uint64_t>& usage);
+};
+
+#endif //CPUSTATS_CPUIDLE_MANAGER_HPP
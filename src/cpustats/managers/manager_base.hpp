@@ -1,14 +1,103 @@
 #ifndef CPUSTATS_MANAGER_BASE_HPP
 #define CPUSTATS_MANAGER_BASE_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+/** Data sources, one per kind of manager */
+enum class Source {
+    cpu,
+    pids,
+    cpuidle,
+    pressure,
+    cgroups,
+    perf_cpu,
+    profile,
+    process_tree,
+};
+
+inline const char *ToString(Source source) {
+    switch (source) {
+        case Source::cpu: return "cpu";
+        case Source::pids: return "pid";
+        case Source::cpuidle: return "cpuidle";
+        case Source::pressure: return "pressure";
+        case Source::cgroups: return "cgroup";
+        case Source::perf_cpu: return "perf-cpu";
+        case Source::profile: return "profile";
+        case Source::process_tree: return "tree";
+        default: return "unknown";
+    }
+}
+
+/** Sources refreshed during an iteration of the main loop */
+class SourceSet {
+public:
+    static SourceSet All() { return SourceSet{~uint32_t{}}; }
+
+    SourceSet() = default;
+
+    void Add(Source source) { bits_ |= Bit(source); }
+    [[nodiscard]] bool Contains(Source source) const { return bits_ & Bit(source); }
+    [[nodiscard]] bool ContainsAny(SourceSet other) const { return bits_ & other.bits_; }
+    [[nodiscard]] bool empty() const { return bits_ == 0; }
+
+private:
+    explicit SourceSet(uint32_t bits) : bits_{bits} {}
+    static uint32_t Bit(Source source) { return uint32_t{1} << static_cast<int>(source); }
+
+    uint32_t bits_{};
+};
+
+/**
+ * Base of acceptor interfaces. Managers skip disabled acceptors, so a
+ * consumer can be switched off at runtime while staying bound. It is
+ * inherited virtually: a consumer implementing several acceptors has
+ * a single switch.
+ */
+class Acceptor {
+public:
+    virtual ~Acceptor() = default;
+
+    [[nodiscard]] bool is_enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> enabled_{true};  // switched by the control socket while consumer threads run
+};
+
 class Manager {
 public:
     virtual void Init() = 0;
-    virtual void Update() = 0;
+
+    /**
+     * Read the source without calling acceptors. Managers due on the same
+     * tick sample concurrently, so only the manager's own state is touched.
+     */
+    virtual void Sample() = 0;
+
+    /** Pass values of the last Sample() to acceptors, on the main loop thread */
+    virtual void Publish() = 0;
+
     virtual void Finish() = 0;
+
+    void Update() {
+        Sample();
+        Publish();
+    }
+
+    /** Source refreshed by Sample() */
+    [[nodiscard]] virtual Source source() const = 0;
+
+    /** Sampling period, zero to update on every tick of the main loop */
+    void set_period(std::chrono::nanoseconds period) { period_ = period; }
+    [[nodiscard]] std::chrono::nanoseconds period() const { return period_; }
+
+private:
+    std::chrono::nanoseconds period_{};
 };
 
 #endif //CPUSTATS_MANAGER_BASE_HPP
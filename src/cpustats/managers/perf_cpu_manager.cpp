@@ -0,0 +1,127 @@
+#include "perf_cpu_manager.hpp"
+#include "../system/linux_proc.hpp"
+#include "../system/linux_sysfs.hpp"
+#include "../system/proc_root.hpp"
+
+#include <linux/perf_event.h>
+
+#include <iostream>
+
+namespace {
+
+enum EventIndex {
+    kCpuClock,
+    kContextSwitches,
+    kMigrations,
+    kPageFaults,
+    kCycles,
+    kInstructions,
+};
+
+constexpr PerfEventSpec kEvents[] = {
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true},
+};
+
+}
+
+
+void PerfCpuManager::Init() {
+    auto cpu_info_list = LoadProcCpuInfo();
+    std::span<const PerfEventSpec> events{kEvents};
+    if (!hardware_events_) {
+        events = events.first(kCycles);
+    }
+    for (auto const& cpu_info: cpu_info_list) {
+        Cpu cpu{};
+        cpu.stat.cpu = cpu_info.cpu;
+        if (int error = cpu.group.Open(-1, cpu_info.cpu, events); error != 0) {
+            // Most likely the same reason for all CPUs, so stop here
+            std::cerr << "Can not open perf events on cpu" << cpu_info.cpu << ": "
+                      << PerfErrorMessage(error) << ", per-CPU perf stats disabled\n";
+            cpus_.clear();
+            return;
+        }
+        if (hardware_events_ && !cpu.group.has_event(kCycles)) {
+            std::cerr << "Hardware counters are not available on cpu" << cpu_info.cpu << "\n";
+        }
+        for (auto const& state: LoadCpuIdleStates(cpu_info.cpu)) {
+            cpu.idle_time_files.emplace_back().OpenAt(
+                    ProcRoot::Instance().sys_fd(), CpuIdleStatePath(state.cpu, state.state) + "/time");
+        }
+        cpu.group.Read(cpu.prev);
+        cpu.prev_idle_us = ReadIdleTime(cpu).value_or(0);
+        cpus_.push_back(std::move(cpu));
+    }
+}
+
+
+void PerfCpuManager::Sample() {
+    PerfGroupValues curr{};
+    n_valid_ = 0;
+    for (auto& cpu: cpus_) {
+        cpu.valid = false;
+        if (!cpu.group.Read(curr)) {
+            continue;
+        }
+        auto& stat = cpu.stat;
+        stat.clock_ns = curr.Delta(cpu.prev, kCpuClock);
+        if (stat.clock_ns == 0) {
+            continue;
+        }
+        double seconds = static_cast<double>(stat.clock_ns) * 1e-9;
+        auto rate = [&](size_t index) {
+            return static_cast<double>(curr.Delta(cpu.prev, index)) / seconds;
+        };
+        stat.context_switches_rate = rate(kContextSwitches);
+        stat.migrations_rate = rate(kMigrations);
+        stat.page_faults_rate = rate(kPageFaults);
+        if (cpu.group.has_event(kCycles)) {
+            stat.cycles_rate = rate(kCycles);
+        }
+        if (cpu.group.has_event(kInstructions)) {
+            stat.instructions_rate = rate(kInstructions);
+        }
+        if (auto idle_us = ReadIdleTime(cpu)) {
+            auto idle_ns = (*idle_us - cpu.prev_idle_us) * 1000;
+            stat.busy_ns = idle_ns < stat.clock_ns ? stat.clock_ns - idle_ns : 0;
+            cpu.prev_idle_us = *idle_us;
+        }
+        std::swap(cpu.prev, curr);
+        cpu.valid = true;
+        n_valid_++;
+    }
+}
+
+void PerfCpuManager::Publish() {
+    auto n_valid = n_valid_;
+    for (auto const& cpu: cpus_) {
+        if (!cpu.valid) continue;
+        bool last_in_iter = --n_valid == 0;
+        for (auto const& acceptor: acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(cpu.stat, last_in_iter);
+        }
+    }
+}
+
+
+void PerfCpuManager::Finish() {
+    cpus_.clear();
+}
+
+
+std::optional<uint64_t> PerfCpuManager::ReadIdleTime(Cpu const& cpu) {
+    if (cpu.idle_time_files.empty()) {
+        return std::nullopt;
+    }
+    uint64_t idle_us{};
+    for (auto const& file: cpu.idle_time_files) {
+        idle_us += file.ReadUInt64().value_or(0);
+    }
+    return idle_us;
+}
@@ -0,0 +1,76 @@
+#ifndef CPUSTATS_PERF_CPU_MANAGER_HPP
+#define CPUSTATS_PERF_CPU_MANAGER_HPP
+
+#include "manager_base.hpp"
+#include "../system/linux_perf.hpp"
+#include "../system/persistent_file.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+
+/**
+ * Per-CPU perf counters during the last interval. Rates are per second
+ * of `clock_ns`, the time the counters were enabled on the CPU.
+ */
+struct PerfCpuStat {
+    int cpu{};
+    uint64_t clock_ns{};
+    std::optional<uint64_t> busy_ns{};  // clock_ns minus cpuidle residency
+    double context_switches_rate{};
+    double migrations_rate{};
+    double page_faults_rate{};
+    std::optional<double> cycles_rate{};
+    std::optional<double> instructions_rate{};
+};
+
+class PerfCpuStatAcceptor : public virtual Acceptor {
+public:
+    virtual ~PerfCpuStatAcceptor() = default;
+    virtual void Accept(PerfCpuStat const& value, bool last_in_iter = false) = 0;
+};
+
+
+/**
+ * Opens a group of software perf events (cpu-clock, context-switches,
+ * cpu-migrations, page-faults, and optionally hardware cycles and
+ * instructions) on each CPU and reads each group with a single `read()`.
+ *
+ * CPU-wide cpu-clock runs during idle too, so busy time is derived by
+ * subtracting cpuidle states residency, when cpuidle is available.
+ */
+class PerfCpuManager : public Manager {
+public:
+    void set_hardware_events(bool enabled) { hardware_events_ = enabled; }
+
+    void Init() override;
+    void Sample() override;
+    void Publish() override;
+    void Finish() override;
+    [[nodiscard]] Source source() const override { return Source::perf_cpu; }
+
+    void add_acceptor(std::shared_ptr<PerfCpuStatAcceptor> acceptor) {
+        acceptors_.push_back(std::move(acceptor));
+    }
+
+private:
+    struct Cpu {
+        PerfEventGroup group{};
+        PerfGroupValues prev{};
+        std::vector<PersistentFile> idle_time_files{};
+        uint64_t prev_idle_us{};
+        PerfCpuStat stat{};
+        bool valid{false};
+    };
+
+    std::vector<std::shared_ptr<PerfCpuStatAcceptor>> acceptors_{};
+    bool hardware_events_{false};
+    std::vector<Cpu> cpus_{};
+    size_t n_valid_{};  // CPUs read by the last Sample()
+
+    static std::optional<uint64_t> ReadIdleTime(Cpu const& cpu);
+};
+
+#endif //CPUSTATS_PERF_CPU_MANAGER_HPP
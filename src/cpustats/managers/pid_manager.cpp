@@ -1,19 +1,332 @@
 #include "pid_manager.hpp"
+#include "../system/linux_cgroup.hpp"
 
-void PidManager::Init() {}
+#include <linux/perf_event.h>
+#include <unistd.h>
 
-void PidManager::Update() {
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+enum PerfEventIndex {
+    kTaskClock,
+    kContextSwitches,
+    kMigrations,
+    kCycles,
+    kInstructions,
+};
+
+constexpr PerfEventSpec kPerfEvents[] = {
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true},
+};
+
+}
+
+void PidManager::Init() {
     if (track_all_) {
-        pids_list_ = ListPids();
+        proc_scan_->add_stats_source(Source::pids);
     }
-    for (auto pid: pids_list_) {
+    if (perf_counters_ && track_all_) {
+        std::cerr << "Per-thread perf counters are not used when tracking all PIDs\n";
+        perf_counters_ = false;
+    }
+    if (placement_tracking_) {
+        topology_ = LoadCpuTopology();
+    }
+    if (run_queue_stats_) {
+        auto num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+        run_queues_.resize(num_cpus > 0 ? num_cpus : 1);
+        for (int cpu{}; cpu < run_queues_.size(); cpu++) {
+            run_queues_[cpu].cpu = cpu;
+        }
+    }
+}
+
+void PidManager::Sample() {
+    ListTickPids();
+    update_generation_++;
+    tick_stats_.clear();
+    exited_placements_.clear();
+    for (auto& run_queue: run_queues_) {
+        run_queue.running = run_queue.waiting = 0;
+    }
+    for (auto pid: tick_pids_) {
         PidStat stat{.pid = pid};
-        ReadProcPidStat(pid, stat);
-        for (size_t i{}; i < acceptors_.size(); i++) {
-            auto last_in_cycle = i +1 == acceptors_.size();
-            acceptors_.at(i)->Accept(stat, last_in_cycle);
+        proc_scan_->ReadStat(pid, stat);
+        if (comm_regex_ && !CheckCommMatch(stat)) {
+            continue;
+        }
+        if (run_queue_stats_ && stat.cpu >= 0 && stat.cpu < run_queues_.size()) {
+            if (stat.state == PidStat::State::running) {
+                run_queues_[stat.cpu].running++;
+            } else if (stat.state == PidStat::State::waiting) {
+                run_queues_[stat.cpu].waiting++;
+            }
+        }
+        if (perf_counters_ && stat.state != PidStat::State::not_found) {
+            UpdatePerfCounters(stat);
+        }
+        if (placement_tracking_ && stat.state != PidStat::State::not_found) {
+            UpdatePlacement(stat);
         }
+        if (affinity_check_ && stat.state != PidStat::State::not_found) {
+            CheckAffinity(stat);
+        }
+        tick_stats_.push_back(stat);
+    }
+
+    if (perf_counters_) {
+        // Detach counters from threads that exited or are no longer tracked
+        std::erase_if(perf_counters_list_, [this](auto const& item) {
+            return item.second.generation != update_generation_;
+        });
+    }
+    if (affinity_check_) {
+        std::erase_if(affinities_, [this](auto const& item) {
+            return item.second.generation != update_generation_;
+        });
+    }
+    if (placement_tracking_) {
+        // Residency of exited threads is passed on by Publish(), not kept until the end of the run
+        std::erase_if(placements_, [this](auto& item) {
+            if (item.second.generation == update_generation_) {
+                return false;
+            }
+            exited_placements_.push_back(std::move(item.second.placement));
+            return true;
+        });
     }
 }
 
-void PidManager::Finish() {}
+void PidManager::Publish() {
+    for (auto const& acceptor: acceptors_) {
+        if (!acceptor->is_enabled()) continue;
+        acceptor->Accept(std::span<const PidStat>{tick_stats_});
+    }
+
+    for (size_t i{}; i < run_queues_.size(); i++) {
+        auto last_in_cycle = i + 1 == run_queues_.size();
+        for (auto const& acceptor: run_queue_acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(run_queues_[i], last_in_cycle);
+        }
+    }
+
+    PublishPlacements(exited_placements_);
+}
+
+void PidManager::Finish() {
+    perf_counters_list_.clear();
+    affinities_.clear();
+    if (placement_tracking_) {
+        exited_placements_.clear();
+        for (auto& [pid, item]: placements_) {
+            exited_placements_.push_back(std::move(item.placement));
+        }
+        placements_.clear();
+        std::sort(exited_placements_.begin(), exited_placements_.end(),
+                  [](auto const& a, auto const& b) { return a.pid < b.pid; });
+        PublishPlacements(exited_placements_);
+        exited_placements_.clear();
+    }
+}
+
+void PidManager::PublishPlacements(std::vector<ThreadPlacement> const& placements) {
+    for (size_t i{}; i < placements.size(); i++) {
+        auto last_in_iter = i + 1 == placements.size();
+        for (auto const& acceptor: placement_acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(placements[i], last_in_iter);
+        }
+    }
+}
+
+void PidManager::ListTickPids() {
+    if (track_all_) {
+        tick_pids_ = proc_scan_->Pids();
+        return;
+    }
+    tick_pids_ = pids_list_;
+    if (!comm_regex_ && cgroup_path_.empty()) {
+        return;
+    }
+    if (comm_regex_) {
+        UpdateCommMatches();
+        for (auto const& match: comm_matches_) {
+            if (match.matched) {
+                tick_pids_.push_back(match.pid);
+            }
+        }
+    }
+    if (!cgroup_path_.empty()) {
+        auto tids = ReadCgroupThreads(cgroup_path_);
+        tick_pids_.insert(tick_pids_.end(), tids.begin(), tids.end());
+    }
+    std::sort(tick_pids_.begin(), tick_pids_.end());
+    tick_pids_.erase(std::unique(tick_pids_.begin(), tick_pids_.end()), tick_pids_.end());
+}
+
+void PidManager::UpdateCommMatches() {
+    // Both the listing and the matches are sorted by PID: matches of PIDs
+    // gone from the listing are dropped, and only PIDs new to it are read
+    std::swap(comm_matches_, prev_comm_matches_);
+    comm_matches_.clear();
+    auto prev = prev_comm_matches_.begin();
+    for (int pid: proc_scan_->Pids()) {
+        while (prev != prev_comm_matches_.end() && prev->pid < pid) {
+            ++prev;
+        }
+        if (prev != prev_comm_matches_.end() && prev->pid == pid) {
+            comm_matches_.push_back(*prev);
+            continue;
+        }
+        PidStat stat{.pid = pid};
+        proc_scan_->ReadStat(pid, stat);
+        if (stat.state == PidStat::State::not_found) {
+            continue;
+        }
+        comm_matches_.push_back(CommMatch{.pid = pid, .starttime = stat.starttime, .matched = MatchComm(stat)});
+    }
+}
+
+bool PidManager::MatchComm(PidStat const& stat) const {
+    return std::regex_search(stat.comm.data(), *comm_regex_);
+}
+
+bool PidManager::CheckCommMatch(PidStat const& stat) {
+    auto match = std::lower_bound(comm_matches_.begin(), comm_matches_.end(), stat.pid,
+                                  [](auto const& item, int pid) { return item.pid < pid; });
+    if (match == comm_matches_.end() || match->pid != stat.pid ||
+        stat.state == PidStat::State::not_found || match->starttime == stat.starttime) {
+        return true;
+    }
+    // PID was reused by another process between two listings
+    match->starttime = stat.starttime;
+    match->matched = MatchComm(stat);
+    return match->matched || std::find(pids_list_.begin(), pids_list_.end(), stat.pid) != pids_list_.end();
+}
+
+void PidManager::UpdatePerfCounters(PidStat& stat) {
+    auto [it, inserted] = perf_counters_list_.try_emplace(stat.pid);
+    auto& counters = it->second;
+    counters.generation = update_generation_;
+    if (!inserted && counters.starttime != stat.starttime) {
+        // Thread ID was reused, counters belong to the old thread
+        counters.group.Close();
+        counters.open_failed = false;
+    }
+    if (counters.open_failed) {
+        // Not retried for the same thread, the failure is likely permanent (perf_event_paranoid)
+        return;
+    }
+    if (!counters.group.is_open()) {
+        counters.starttime = stat.starttime;
+        if (int error = counters.group.Open(stat.pid, -1, kPerfEvents); error != 0) {
+            if (!perf_error_reported_) {
+                std::cerr << "Can not attach perf counters to thread " << stat.pid
+                          << ": " << PerfErrorMessage(error) << "\n";
+                perf_error_reported_ = true;
+            }
+            counters.open_failed = true;
+            return;
+        }
+        counters.group.Read(counters.prev);
+        return;
+    }
+    PerfGroupValues curr{};
+    if (!counters.group.Read(curr)) {
+        return;
+    }
+    auto const& prev = counters.prev;
+    PidPerfStat perf{};
+    perf.task_clock_ns = curr.Delta(prev, kTaskClock);
+    perf.context_switches = curr.Delta(prev, kContextSwitches);
+    perf.migrations = curr.Delta(prev, kMigrations);
+    if (counters.group.has_event(kCycles)) {
+        perf.cycles = curr.Delta(prev, kCycles);
+    }
+    if (counters.group.has_event(kInstructions)) {
+        perf.instructions = curr.Delta(prev, kInstructions);
+    }
+    stat.perf = perf;
+    counters.prev = std::move(curr);
+}
+
+void PidManager::UpdatePlacement(PidStat& stat) {
+    auto [it, inserted] = placements_.try_emplace(stat.pid);
+    auto& item = it->second;
+    if (!inserted && item.starttime != stat.starttime) {
+        // Thread ID was reused, report the old thread separately
+        exited_placements_.push_back(std::move(item.placement));
+        item = Placement{};
+        inserted = true;
+    }
+    item.generation = update_generation_;
+    auto& placement = item.placement;
+    if (inserted) {
+        item.starttime = stat.starttime;
+        placement.pid = stat.pid;
+        placement.residency.resize(std::max<size_t>(topology_.size(), 1));
+    }
+    placement.comm = stat.comm;
+    placement.migrations.last = CpuMigration::none;
+    if (stat.cpu >= 0) {
+        if (stat.cpu >= placement.residency.size()) {
+            placement.residency.resize(stat.cpu + 1);
+        }
+        placement.residency[stat.cpu]++;
+        if (item.last_cpu >= 0 && item.last_cpu != stat.cpu) {
+            auto& migrations = placement.migrations;
+            migrations.last = ClassifyMigration(item.last_cpu, stat.cpu);
+            switch (migrations.last) {
+                case CpuMigration::smt: migrations.smt++; break;
+                case CpuMigration::same_socket: migrations.same_socket++; break;
+                default: migrations.cross_socket++; break;
+            }
+        }
+        item.last_cpu = stat.cpu;
+    }
+    stat.migrations = placement.migrations;
+}
+
+CpuMigration PidManager::ClassifyMigration(int from, int to) const {
+    if (from >= topology_.size() || to >= topology_.size()) {
+        return CpuMigration::cross_socket;
+    }
+    auto const& a = topology_[from];
+    auto const& b = topology_[to];
+    if (a.package_id < 0 || a.package_id != b.package_id) {
+        return CpuMigration::cross_socket;
+    }
+    if (a.core_id >= 0 && a.core_id == b.core_id) {
+        return CpuMigration::smt;
+    }
+    return CpuMigration::same_socket;
+}
+
+void PidManager::CheckAffinity(PidStat& stat) {
+    auto [it, inserted] = affinities_.try_emplace(stat.pid);
+    auto& affinity = it->second;
+    if (inserted || affinity.starttime != stat.starttime) {
+        affinity = Affinity{.starttime = stat.starttime, .mask = ReadThreadAffinity(stat.pid)};
+    }
+    affinity.generation = update_generation_;
+    if (affinity.mask && !affinity.mask->Test(stat.cpu)) {
+        stat.affinity_violation = AffinityViolation::outside_affinity;
+    } else if (reserved_cpus_.Test(stat.cpu) &&
+               std::find(pids_list_.begin(), pids_list_.end(), stat.pid) == pids_list_.end()) {
+        stat.affinity_violation = AffinityViolation::foreign;
+    }
+    if (stat.affinity_violation != AffinityViolation::none && !affinity.reported) {
+        // Report each thread once, the flag is also set in every PidStat
+        std::cerr << "Thread " << stat.pid << " (" << stat.comm.data() << ") found on CPU " << stat.cpu
+                  << (stat.affinity_violation == AffinityViolation::foreign ? ", reserved" : "")
+                  << (affinity.mask ? ", affinity " + affinity.mask->ToString() : "") << "\n";
+        affinity.reported = true;
+    }
+}
@@ -2,15 +2,72 @@
 #define CPUSTATS_PID_MANAGER_HPP
 
 #include "manager_base.hpp"
+#include "proc_scan.hpp"
+#include "../system/cpu_mask.hpp"
+#include "../system/linux_perf.hpp"
 #include "../system/linux_proc.hpp"
+#include "../system/linux_sysfs.hpp"
 
 #include <memory>
+#include <optional>
+#include <regex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 
-class PidStatAcceptor {
+class PidStatAcceptor : public virtual Acceptor {
 public:
     virtual ~PidStatAcceptor() = default;
     virtual void Accept(PidStat const& value, bool last_in_cycle = false) = 0;
+
+    /**
+     * All PIDs of a tick at once, a view into the manager's buffer valid
+     * during the call. By default passed on one by one.
+     */
+    virtual void Accept(std::span<const PidStat> values) {
+        for (size_t i{}; i < values.size(); i++) {
+            Accept(values[i], i + 1 == values.size());
+        }
+    }
+};
+
+
+/**
+ * Number of tracked tasks in R (running or runnable) and D
+ * (uninterruptible sleep) state last seen on the CPU, an approximation
+ * of the run queue depth.
+ */
+struct CpuRunQueue {
+    int cpu{};
+    int running{};
+    int waiting{};
+};
+
+class CpuRunQueueAcceptor : public virtual Acceptor {
+public:
+    virtual ~CpuRunQueueAcceptor() = default;
+    virtual void Accept(CpuRunQueue const& value, bool last_in_cycle = false) = 0;
+};
+
+
+/**
+ * Number of observations of a thread on each CPU during the run and
+ * its migrations. Emitted once the thread exits, or when the manager
+ * finishes for threads still running.
+ */
+struct ThreadPlacement {
+    int pid{};
+    std::array<char, PidStat::kCommSize> comm{};
+    std::vector<uint32_t> residency{};  // indexed by CPU
+    PidMigrationStat migrations{};
+};
+
+class ThreadPlacementAcceptor : public virtual Acceptor {
+public:
+    virtual ~ThreadPlacementAcceptor() = default;
+    virtual void Accept(ThreadPlacement const& value, bool last_in_iter = false) = 0;
 };
 
 
@@ -19,22 +76,149 @@ public:
     void set_track_all(bool enabled) { track_all_ = enabled; }
     [[nodiscard]] bool track_all() const { return track_all_; }
 
+    /** Track processes whose command name (`comm`, read once per process) matches the regex */
+    void set_comm_filter(std::string const& pattern) { comm_regex_ = std::regex{pattern}; }
+
+    /** Pass over /proc used to list all PIDs and read their stat, shared with other managers */
+    void set_proc_scan(std::shared_ptr<ProcScan> proc_scan) { proc_scan_ = std::move(proc_scan); }
+
+    /** Track threads of the cgroup (v2) in the given directory */
+    void set_cgroup_filter(std::string path) { cgroup_path_ = std::move(path); }
+
+    /**
+     * Attach a perf counters group (task-clock, context-switches,
+     * cpu-migrations, cycles and instructions where available) to each
+     * tracked thread. Not used with `track_all`.
+     */
+    void set_perf_counters(bool enabled) { perf_counters_ = enabled; }
+
+    /**
+     * Count tasks in R and D state per CPU while scanning and emit
+     * the counts for every CPU after the scan.
+     */
+    void set_run_queue_stats(bool enabled) { run_queue_stats_ = enabled; }
+
+    /**
+     * Keep the last CPU of each tracked thread to count migrations
+     * (by topology distance) and count observations of the thread on
+     * each CPU. Residency of a thread is emitted on the tick it is found
+     * to have exited, and of threads still running in Finish().
+     */
+    void set_placement_tracking(bool enabled) { placement_tracking_ = enabled; }
+
+    /**
+     * Check the CPU of every tracked thread against its affinity, read
+     * once when the thread is first seen (or its TID is reused), and
+     * flag threads found outside of it. Threads other than those added
+     * with add_pid() are also flagged when found on reserved CPUs.
+     */
+    void set_affinity_check(bool enabled) { affinity_check_ = enabled; }
+    void set_reserved_cpus(std::vector<int> const& cpus) { reserved_cpus_ = CpuMask{cpus}; }
+
     void Init() override;
-    void Update() override;
+    void Sample() override;
+    void Publish() override;
     void Finish() override;
+    [[nodiscard]] Source source() const override { return Source::pids; }
 
     void add_acceptor(std::shared_ptr<PidStatAcceptor> acceptor) {
         acceptors_.push_back(std::move(acceptor));
     }
 
+    void add_acceptor(std::shared_ptr<CpuRunQueueAcceptor> acceptor) {
+        run_queue_acceptors_.push_back(std::move(acceptor));
+    }
+
+    void add_acceptor(std::shared_ptr<ThreadPlacementAcceptor> acceptor) {
+        placement_acceptors_.push_back(std::move(acceptor));
+    }
+
     void add_pid(int pid) {
         pids_list_.push_back(pid);
     }
 
+    /** Stop tracking the PID given with add_pid(), false if it was not tracked */
+    bool remove_pid(int pid) {
+        return std::erase(pids_list_, pid) > 0;
+    }
+
+    [[nodiscard]] bool is_tracking_all() const { return track_all_; }
+    [[nodiscard]] std::vector<int> const& pids() const { return pids_list_; }
+
 private:
+    /**
+     * Result of matching a process against the comm filter. A process is
+     * classified when its PID first shows up in the listing, and again
+     * only if its PID is found reused while it is tracked.
+     */
+    struct CommMatch {
+        int pid{};
+        unsigned long long starttime{};
+        bool matched{false};
+    };
+
     std::vector<std::shared_ptr<PidStatAcceptor>> acceptors_{};
     std::vector<int> pids_list_{};
     bool track_all_{false};
+    std::shared_ptr<ProcScan> proc_scan_{std::make_shared<ProcScan>()};
+
+    std::optional<std::regex> comm_regex_{};
+    std::string cgroup_path_{};
+    std::vector<CommMatch> comm_matches_{};  // of PIDs in the last listing, sorted
+    std::vector<CommMatch> prev_comm_matches_{};
+    std::vector<int> tick_pids_{};
+    std::vector<PidStat> tick_stats_{};  // read by the last Sample()
+
+    struct PerfCounters {
+        PerfEventGroup group{};
+        PerfGroupValues prev{};
+        unsigned long long starttime{};
+        unsigned generation{};
+        bool open_failed{false};  // until the thread ID is reused
+    };
+
+    bool perf_counters_{false};
+    bool perf_error_reported_{false};
+    std::unordered_map<int, PerfCounters> perf_counters_list_{};
+    unsigned update_generation_{};
+
+    bool run_queue_stats_{false};
+    std::vector<std::shared_ptr<CpuRunQueueAcceptor>> run_queue_acceptors_{};
+    std::vector<CpuRunQueue> run_queues_{};  // indexed by CPU, sized once
+
+    struct Placement {
+        unsigned long long starttime{};
+        unsigned generation{};
+        ThreadPlacement placement{};
+        int last_cpu{-1};
+    };
+
+    bool placement_tracking_{false};
+    std::vector<std::shared_ptr<ThreadPlacementAcceptor>> placement_acceptors_{};
+    std::vector<CpuTopology> topology_{};
+    std::unordered_map<int, Placement> placements_{};
+    std::vector<ThreadPlacement> exited_placements_{};  // during the last Sample()
+
+    struct Affinity {
+        unsigned long long starttime{};
+        unsigned generation{};
+        std::optional<CpuMask> mask{};
+        bool reported{false};
+    };
+
+    bool affinity_check_{false};
+    CpuMask reserved_cpus_{};
+    std::unordered_map<int, Affinity> affinities_{};
+
+    void ListTickPids();
+    void UpdateCommMatches();
+    bool MatchComm(PidStat const& stat) const;
+    bool CheckCommMatch(PidStat const& stat);
+    void UpdatePerfCounters(PidStat& stat);
+    void UpdatePlacement(PidStat& stat);
+    void PublishPlacements(std::vector<ThreadPlacement> const& placements);
+    void CheckAffinity(PidStat& stat);
+    CpuMigration ClassifyMigration(int from, int to) const;
 };
 
 
@@ -0,0 +1,181 @@
+#include "pressure_manager.hpp"
+#include "../system/proc_root.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+
+const char *ToString(PressureResource resource) {
+    switch (resource) {
+        case PressureResource::cpu: return "cpu";
+        case PressureResource::memory: return "memory";
+        case PressureResource::io: return "io";
+        default: return "unknown";
+    }
+}
+
+
+PressureManager::~PressureManager() {
+    StopWatcher();
+}
+
+void PressureManager::Init() {
+    static constexpr PressureResource kResources[] = {
+            PressureResource::cpu,
+            PressureResource::memory,
+            PressureResource::io
+    };
+    for (auto resource: kResources) {
+        AddSource("system", std::string{"pressure/"} + ToString(resource), resource, ProcRoot::Instance().proc_fd());
+    }
+    for (auto const& cgroup: cgroups_list_) {
+        for (auto resource: kResources) {
+            AddSource(cgroup, cgroup + "/" + ToString(resource) + ".pressure", resource);
+        }
+    }
+    prev_time_ = std::chrono::steady_clock::now();
+
+    if (!trigger_.empty()) {
+        for (auto& source: sources_) {
+            RegisterTrigger(source);
+        }
+        stop_fd_ = eventfd(0, EFD_CLOEXEC);
+        watcher_ = std::thread{[this]() { WatchTriggers(); }};
+    }
+}
+
+void PressureManager::Sample() {
+    n_valid_ = 0;
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration<double, std::micro>(now - prev_time_).count();
+    prev_time_ = now;
+    if (elapsed_us <= 0) {
+        return;
+    }
+
+    char buf[256];
+    for (auto& source: sources_) {
+        PressureTotals curr{};
+        if (source.file.Read(buf, sizeof(buf)) <= 0 || !ParsePressure(buf, curr)) {
+            source.valid = false;
+            continue;
+        }
+        source.stat.some_rate = static_cast<double>(curr.some_us - source.prev.some_us) / elapsed_us;
+        if (curr.full_us && source.prev.full_us) {
+            source.stat.full_rate = static_cast<double>(*curr.full_us - *source.prev.full_us) / elapsed_us;
+        } else {
+            source.stat.full_rate = std::nullopt;
+        }
+        source.prev = curr;
+        source.valid = true;
+        n_valid_++;
+    }
+}
+
+void PressureManager::Publish() {
+    // Nothing was read if Sample() returned early, flags are stale then
+    auto n_valid = n_valid_;
+    if (n_valid == 0) {
+        return;
+    }
+    for (auto const& source: sources_) {
+        if (!source.valid) continue;
+        bool last_in_iter = --n_valid == 0;
+        for (auto const& acceptor: acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(source.stat, last_in_iter);
+        }
+    }
+}
+
+void PressureManager::Finish() {
+    StopWatcher();
+}
+
+void PressureManager::AddSource(
+        std::string const& name,
+        std::string const& path,
+        PressureResource resource,
+        int dir_fd
+) {
+    Source source{};
+    if (!source.file.OpenAt(dir_fd, path)) {
+        std::cerr << "Error opening " << path << ": " << std::strerror(errno) << "\n";
+        return;
+    }
+    char buf[256];
+    if (source.file.Read(buf, sizeof(buf)) <= 0 || !ParsePressure(buf, source.prev)) {
+        std::cerr << "Error reading PSI from " << path << "\n";
+        return;
+    }
+    source.stat.source = name;
+    source.stat.resource = resource;
+    sources_.push_back(std::move(source));
+}
+
+void PressureManager::RegisterTrigger(Source& source) {
+    // Trigger lives as long as the file descriptor it was written to is open
+    auto const& path = source.file.path();
+    if (!source.trigger.OpenAt(source.file.dir_fd(), path, O_RDWR | O_NONBLOCK)) {
+        std::cerr << "Can not register PSI trigger on " << path
+                  << ": " << std::strerror(errno) << "\n";
+        return;
+    }
+    if (write(source.trigger.fd(), trigger_.c_str(), trigger_.size() + 1) < 0) {
+        std::cerr << "Can not register PSI trigger \"" << trigger_ << "\" on "
+                  << path << ": " << std::strerror(errno) << "\n";
+        source.trigger.Close();
+    }
+}
+
+void PressureManager::WatchTriggers() {
+    std::vector<pollfd> fds{};
+    fds.push_back({.fd = stop_fd_, .events = POLLIN, .revents = 0});
+    for (auto const& source: sources_) {
+        if (source.trigger.is_open()) {
+            fds.push_back({.fd = source.trigger.fd(), .events = POLLPRI, .revents = 0});
+        }
+    }
+    while (true) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "PSI trigger poll failed: " << std::strerror(errno) << "\n";
+            return;
+        }
+        if (fds[0].revents) {
+            return;
+        }
+        bool triggered{false};
+        for (size_t i{1}; i < fds.size(); i++) {
+            if (fds[i].revents & POLLERR) {
+                // The monitored cgroup was removed, stop watching it
+                fds[i].fd = -1;
+            } else if (fds[i].revents & POLLPRI) {
+                triggered = true;
+            }
+        }
+        if (triggered && trigger_callback_) {
+            trigger_callback_();
+        }
+    }
+}
+
+void PressureManager::StopWatcher() {
+    if (watcher_.joinable()) {
+        uint64_t value{1};
+        if (write(stop_fd_, &value, sizeof(value)) < 0) {
+            std::cerr << "Error stopping PSI trigger watcher\n";
+        }
+        watcher_.join();
+    }
+    if (stop_fd_ >= 0) {
+        close(stop_fd_);
+        stop_fd_ = -1;
+    }
+}
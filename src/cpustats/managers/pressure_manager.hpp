@@ -0,0 +1,100 @@
+#ifndef CPUSTATS_PRESSURE_MANAGER_HPP
+#define CPUSTATS_PRESSURE_MANAGER_HPP
+
+#include "manager_base.hpp"
+#include "../system/linux_proc.hpp"
+#include "../system/persistent_file.hpp"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+enum class PressureResource {
+    cpu,
+    memory,
+    io
+};
+
+const char *ToString(PressureResource resource);
+
+
+/**
+ * Share of the interval during which some (or all) non-idle tasks
+ * were stalled on the resource, computed from the `total=` deltas.
+ */
+struct PressureStat {
+    std::string source{};  // "system" or cgroup directory
+    PressureResource resource{};
+    double some_rate{};
+    std::optional<double> full_rate{};
+};
+
+class PressureStatAcceptor : public virtual Acceptor {
+public:
+    virtual ~PressureStatAcceptor() = default;
+    virtual void Accept(PressureStat const& value, bool last_in_iter = false) = 0;
+};
+
+
+/**
+ * Reads Pressure Stall Information of the whole system (`/proc/pressure/`)
+ * and, optionally, of cgroups (`<cgroup>/<resource>.pressure`).
+ *
+ * If a trigger is set (in kernel format, e.g. "some 150000 1000000"),
+ * it is registered on each PSI file and a watcher thread calls the
+ * trigger callback as soon as the kernel reports a stall, so that
+ * the main loop can sample pressure without waiting for the interval.
+ */
+class PressureManager : public Manager {
+public:
+    ~PressureManager();
+
+    void Init() override;
+    void Sample() override;
+    void Publish() override;
+    void Finish() override;
+    [[nodiscard]] ::Source source() const override { return ::Source::pressure; }
+
+    void add_acceptor(std::shared_ptr<PressureStatAcceptor> acceptor) {
+        acceptors_.push_back(std::move(acceptor));
+    }
+
+    void add_cgroup(std::string path) {
+        cgroups_list_.push_back(std::move(path));
+    }
+
+    void set_trigger(std::string trigger) { trigger_ = std::move(trigger); }
+    void set_trigger_callback(std::function<void()> callback) { trigger_callback_ = std::move(callback); }
+
+private:
+    struct Source {
+        PersistentFile file{};
+        PersistentFile trigger{};
+        PressureStat stat{};
+        PressureTotals prev{};
+        bool valid{false};
+    };
+
+    std::vector<std::shared_ptr<PressureStatAcceptor>> acceptors_{};
+    std::vector<std::string> cgroups_list_{};
+    std::vector<Source> sources_{};
+    std::chrono::steady_clock::time_point prev_time_{};
+    size_t n_valid_{};  // sources read by the last Sample()
+
+    std::string trigger_{};
+    std::function<void()> trigger_callback_{};
+    std::thread watcher_{};
+    int stop_fd_{-1};
+
+    void AddSource(std::string const& name, std::string const& path, PressureResource resource, int dir_fd = AT_FDCWD);
+    void RegisterTrigger(Source& source);
+    void WatchTriggers();
+    void StopWatcher();
+};
+
+#endif //CPUSTATS_PRESSURE_MANAGER_HPP
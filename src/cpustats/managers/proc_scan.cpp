@@ -0,0 +1,54 @@
+#include "proc_scan.hpp"
+
+#include <algorithm>
+
+
+void ProcScan::Reset(SourceSet refreshed) {
+    std::lock_guard lock{mutex_};
+    reads_stats_ = refreshed.ContainsAny(stats_sources_);
+    listed_ = false;
+    stats_read_ = false;
+}
+
+std::vector<int> const& ProcScan::Pids() {
+    std::lock_guard lock{mutex_};
+    List();
+    return pids_;
+}
+
+std::vector<PidStat> const& ProcScan::Stats() {
+    std::lock_guard lock{mutex_};
+    if (stats_read_) {
+        return stats_;
+    }
+    List();
+    stats_.clear();
+    for (int pid: pids_) {
+        auto& stat = stats_.emplace_back(PidStat{.pid = pid});
+        ReadProcPidStat(pid, stat);
+    }
+    stats_read_ = true;
+    return stats_;
+}
+
+void ProcScan::ReadStat(int pid, PidStat& stat) {
+    if (reads_stats_) {
+        auto const& stats = Stats();
+        auto it = std::lower_bound(stats.begin(), stats.end(), pid,
+                                   [](auto const& item, int value) { return item.pid < value; });
+        if (it != stats.end() && it->pid == pid) {
+            stat = *it;
+            return;
+        }
+    }
+    ReadProcPidStat(pid, stat);
+}
+
+void ProcScan::List() {
+    if (listed_) {
+        return;
+    }
+    pids_ = ListPids();
+    std::sort(pids_.begin(), pids_.end());
+    listed_ = true;
+}
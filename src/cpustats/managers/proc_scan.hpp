@@ -0,0 +1,51 @@
+#ifndef CPUSTATS_PROC_SCAN_HPP
+#define CPUSTATS_PROC_SCAN_HPP
+
+#include "manager_base.hpp"
+#include "../system/linux_proc.hpp"
+
+#include <mutex>
+#include <vector>
+
+/**
+ * Pass over /proc shared by managers due on the same tick: PIDs are
+ * listed at most once, and `stat` of every listed PID is read at most
+ * once. Managers sample concurrently, the first one to ask does the work
+ * and the others wait for it.
+ *
+ * The Scheduler starts a new pass before due managers sample, see
+ * Scheduler::set_proc_scan().
+ */
+class ProcScan {
+public:
+    /** Read `stat` of every PID on ticks the source is refreshed on, set in managers' Init() */
+    void add_stats_source(Source source) { stats_sources_.Add(source); }
+
+    /** Forget the last pass, the next one is for a tick refreshing the sources */
+    void Reset(SourceSet refreshed);
+
+    /** PIDs in /proc, sorted */
+    std::vector<int> const& Pids();
+
+    /** `stat` of each PID of Pids() in the same order, tasks that exited since are not_found */
+    std::vector<PidStat> const& Stats();
+
+    /**
+     * `stat` of the task, taken from Stats() on ticks they are read and
+     * the task was listed, read on its own otherwise.
+     */
+    void ReadStat(int pid, PidStat& stat);
+
+private:
+    std::mutex mutex_{};
+    SourceSet stats_sources_{};
+    bool reads_stats_{false};
+    bool listed_{false};
+    bool stats_read_{false};
+    std::vector<int> pids_{};
+    std::vector<PidStat> stats_{};
+
+    void List();
+};
+
+#endif //CPUSTATS_PROC_SCAN_HPP
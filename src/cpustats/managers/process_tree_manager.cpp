@@ -0,0 +1,190 @@
+#include "process_tree_manager.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+
+void ProcessTreeManager::Init() {
+    ticks_per_second_ = static_cast<double>(sysconf(_SC_CLK_TCK));
+    Scan();
+    for (int root: roots_) {
+        if (!processes_.contains(root)) {
+            std::cerr << "Process " << root << " not found, its tree will be empty\n";
+        }
+        stats_.push_back({.root_pid = root});
+    }
+    // Take CPU time baseline of the initial tree members
+    for (auto& tree: stats_) {
+        CollectTree(tree, 1);
+    }
+    prev_time_ = std::chrono::steady_clock::now();
+}
+
+void ProcessTreeManager::Sample() {
+    sampled_ = false;
+    Scan();
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed_ticks = std::chrono::duration<double>(now - prev_time_).count() * ticks_per_second_;
+    prev_time_ = now;
+    if (elapsed_ticks <= 0) {
+        return;
+    }
+    for (auto& tree: stats_) {
+        CollectTree(tree, elapsed_ticks);
+    }
+    sampled_ = true;
+}
+
+void ProcessTreeManager::Publish() {
+    if (!sampled_) {
+        return;
+    }
+    for (size_t i{}; i < stats_.size(); i++) {
+        bool last_in_iter = i + 1 == stats_.size();
+        for (auto const& acceptor: acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(stats_[i], last_in_iter);
+        }
+    }
+}
+
+void ProcessTreeManager::Finish() {}
+
+void ProcessTreeManager::Scan() {
+    bool initial = processes_.empty();
+    generation_++;
+    std::vector<int> born{};
+    for (int pid: proc_scan_->Pids()) {
+        if (auto it = processes_.find(pid); it != processes_.end()) {
+            it->second.generation = generation_;
+        } else {
+            born.push_back(pid);
+        }
+    }
+
+    // Deaths: unlink from parents and remember children to reparent
+    std::vector<int> orphans{};
+    for (auto it = processes_.begin(); it != processes_.end(); ) {
+        if (it->second.generation == generation_) {
+            ++it;
+            continue;
+        }
+        Unlink(it->first, it->second.ppid);
+        orphans.insert(orphans.end(), it->second.children.begin(), it->second.children.end());
+        it = processes_.erase(it);
+    }
+
+    // Births: stat is read once in process lifetime to learn its parent
+    std::vector<std::pair<int, int>> links{};
+    for (int pid: born) {
+        PidStat stat{.pid = pid};
+        proc_scan_->ReadStat(pid, stat);
+        if (stat.state == PidStat::State::not_found) {
+            continue;
+        }
+        auto& process = processes_[pid];
+        process.ppid = stat.ppid;
+        process.starttime = stat.starttime;
+        process.generation = generation_;
+        process.cpu = stat.cpu;
+        // Whole CPU time of a new process was spent since the last scan
+        process.has_prev_cpu_time = !initial;
+        links.emplace_back(pid, stat.ppid);
+    }
+    for (auto [pid, ppid]: links) {
+        Link(pid, ppid);
+    }
+
+    // Orphans were reparented by the kernel (to init or a subreaper)
+    for (int pid: orphans) {
+        auto it = processes_.find(pid);
+        if (it == processes_.end()) {
+            continue;
+        }
+        PidStat stat{.pid = pid};
+        proc_scan_->ReadStat(pid, stat);
+        if (stat.state != PidStat::State::not_found) {
+            it->second.ppid = stat.ppid;
+            Link(pid, stat.ppid);
+        }
+    }
+}
+
+void ProcessTreeManager::Link(int pid, int ppid) {
+    if (auto it = processes_.find(ppid); it != processes_.end()) {
+        it->second.children.push_back(pid);
+    }
+}
+
+void ProcessTreeManager::Unlink(int pid, int ppid) {
+    if (auto it = processes_.find(ppid); it != processes_.end()) {
+        std::erase(it->second.children, pid);
+    }
+}
+
+void ProcessTreeManager::UpdateCpuTime(int pid, Process& process) {
+    if (process.delta_generation == generation_) {
+        return;
+    }
+    process.delta_generation = generation_;
+    process.cpu_time_delta = 0;
+    PidStat stat{.pid = pid};
+    proc_scan_->ReadStat(pid, stat);
+    if (stat.state == PidStat::State::not_found) {
+        return;
+    }
+    if (stat.starttime != process.starttime) {
+        // PID was reused between scans, this is a new process
+        process.starttime = stat.starttime;
+        process.prev_cpu_time = 0;
+        process.has_prev_cpu_time = true;
+    }
+    auto cpu_time = stat.utime + stat.stime;
+    if (process.has_prev_cpu_time && cpu_time >= process.prev_cpu_time) {
+        process.cpu_time_delta = cpu_time - process.prev_cpu_time;
+    }
+    process.prev_cpu_time = cpu_time;
+    process.has_prev_cpu_time = true;
+    process.cpu = stat.cpu;
+}
+
+void ProcessTreeManager::CollectTree(ProcessTreeStat& tree, double elapsed_ticks) {
+    tree.num_processes = 0;
+    tree.cpu_rate = 0;
+    tree.cpus.clear();
+    tree.members.clear();
+    unsigned long long cpu_time{};
+    stack_.clear();
+    if (processes_.contains(tree.root_pid)) {
+        stack_.push_back(tree.root_pid);
+    }
+    while (!stack_.empty()) {
+        int pid = stack_.back();
+        stack_.pop_back();
+        auto it = processes_.find(pid);
+        if (it == processes_.end()) {
+            continue;
+        }
+        auto& process = it->second;
+        UpdateCpuTime(pid, process);
+        tree.num_processes++;
+        cpu_time += process.cpu_time_delta;
+        tree.cpus.push_back(process.cpu);
+        if (children_breakdown_) {
+            tree.members.push_back({
+                .pid = pid,
+                .ppid = process.ppid,
+                .cpu = process.cpu,
+                .cpu_rate = static_cast<double>(process.cpu_time_delta) / elapsed_ticks
+            });
+        }
+        stack_.insert(stack_.end(), process.children.begin(), process.children.end());
+    }
+    tree.cpu_rate = static_cast<double>(cpu_time) / elapsed_ticks;
+    std::sort(tree.cpus.begin(), tree.cpus.end());
+    tree.cpus.erase(std::unique(tree.cpus.begin(), tree.cpus.end()), tree.cpus.end());
+    std::sort(tree.members.begin(), tree.members.end(),
+              [](auto const& a, auto const& b) { return a.pid < b.pid; });
+}
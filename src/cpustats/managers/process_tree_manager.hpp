@@ -0,0 +1,100 @@
+#ifndef CPUSTATS_PROCESS_TREE_MANAGER_HPP
+#define CPUSTATS_PROCESS_TREE_MANAGER_HPP
+
+#include "manager_base.hpp"
+#include "proc_scan.hpp"
+#include "../system/linux_proc.hpp"
+
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+struct ProcessTreeMember {
+    int pid{};
+    int ppid{};
+    int cpu{};
+    double cpu_rate{};
+};
+
+/**
+ * CPU usage of a process and all its descendants during the last interval.
+ * `cpu_rate` is in CPUs (1.0 = one CPU fully busy). `cpus` lists distinct
+ * CPUs the members were last seen on. `members` is filled only when
+ * per-child breakdown is enabled.
+ */
+struct ProcessTreeStat {
+    int root_pid{};
+    int num_processes{};
+    double cpu_rate{};
+    std::vector<int> cpus{};
+    std::vector<ProcessTreeMember> members{};
+};
+
+class ProcessTreeStatAcceptor : public virtual Acceptor {
+public:
+    virtual ~ProcessTreeStatAcceptor() = default;
+    virtual void Accept(ProcessTreeStat const& value, bool last_in_iter = false) = 0;
+};
+
+
+/**
+ * Aggregates CPU time of process trees.
+ *
+ * Parent-child index is built from `ppid` of every process in `/proc`
+ * and is maintained incrementally: `stat` of a process is read once
+ * when it appears, and then only while it belongs to a tracked tree.
+ * Children of exited processes are re-read, since they get reparented.
+ * PIDs are listed by the ProcScan shared with PidManager, and on ticks
+ * it reads `stat` of every PID anyway those are used instead.
+ */
+class ProcessTreeManager : public Manager {
+public:
+    void add_root(int pid) { roots_.push_back(pid); }
+    void set_children_breakdown(bool enabled) { children_breakdown_ = enabled; }
+    void set_proc_scan(std::shared_ptr<ProcScan> proc_scan) { proc_scan_ = std::move(proc_scan); }
+
+    void Init() override;
+    void Sample() override;
+    void Publish() override;
+    void Finish() override;
+    [[nodiscard]] Source source() const override { return Source::process_tree; }
+
+    void add_acceptor(std::shared_ptr<ProcessTreeStatAcceptor> acceptor) {
+        acceptors_.push_back(std::move(acceptor));
+    }
+
+private:
+    struct Process {
+        int ppid{};
+        unsigned long long starttime{};
+        std::vector<int> children{};
+        unsigned generation{};
+        unsigned long long prev_cpu_time{};
+        bool has_prev_cpu_time{false};
+        unsigned long long cpu_time_delta{};
+        unsigned delta_generation{};  // generation when cpu_time_delta was computed
+        int cpu{};
+    };
+
+    std::vector<std::shared_ptr<ProcessTreeStatAcceptor>> acceptors_{};
+    std::vector<int> roots_{};
+    bool children_breakdown_{false};
+    std::shared_ptr<ProcScan> proc_scan_{std::make_shared<ProcScan>()};
+    std::unordered_map<int, Process> processes_{};
+    unsigned generation_{};
+    std::vector<ProcessTreeStat> stats_{};
+    std::vector<int> stack_{};
+    std::chrono::steady_clock::time_point prev_time_{};
+    bool sampled_{false};
+    double ticks_per_second_{100};
+
+    void Scan();
+    void Link(int pid, int ppid);
+    void Unlink(int pid, int ppid);
+    void UpdateCpuTime(int pid, Process& process);
+    void CollectTree(ProcessTreeStat& tree, double elapsed_ticks);
+};
+
+#endif //CPUSTATS_PROCESS_TREE_MANAGER_HPP
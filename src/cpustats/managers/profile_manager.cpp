@@ -0,0 +1,105 @@
+#include "profile_manager.hpp"
+#include "../system/linux_proc.hpp"
+
+#include <fmt/format.h>
+
+#include <linux/perf_event.h>
+
+#include <algorithm>
+#include <iostream>
+
+
+size_t ProfileManager::StackHash::operator()(std::span<const uint64_t> ips) const {
+    // FNV-1a over instruction pointers
+    uint64_t hash{14695981039346656037ULL};
+    for (auto ip: ips) {
+        hash ^= ip;
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+bool ProfileManager::StackEqual::operator()(std::span<const uint64_t> a, std::span<const uint64_t> b) const {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+
+void ProfileManager::Init() {
+    for (int pid: pids_list_) {
+        auto thread = std::make_unique<Thread>();
+        thread->tid = pid;
+        thread->comm = ReadProcPidComm(pid).value_or("unknown");
+        if (int error = thread->sampler.Open(pid, frequency_); error != 0) {
+            std::cerr << "Can not profile thread " << pid << ": " << PerfErrorMessage(error) << "\n";
+            continue;
+        }
+        symbolizer_.LoadMaps(pid);
+        threads_.push_back(std::move(thread));
+    }
+}
+
+void ProfileManager::Sample() {
+    Drain();
+}
+
+void ProfileManager::Publish() {
+    // Stacks are passed on only by Finish()
+}
+
+void ProfileManager::Finish() {
+    Drain();
+
+    std::vector<FoldedStack> folded_stacks{};
+    for (auto& thread: threads_) {
+        thread->sampler.Close();
+        if (thread->sampler.lost() > 0) {
+            std::cerr << "Profiler lost " << thread->sampler.lost()
+                      << " samples of thread " << thread->tid << "\n";
+        }
+        // Libraries could be loaded after Init(), so refresh maps if possible
+        symbolizer_.LoadMaps(thread->tid);
+        std::unordered_map<uint64_t, std::string> names{};
+        for (auto const& [ips, count]: thread->stacks) {
+            auto& folded = folded_stacks.emplace_back();
+            folded.tid = thread->tid;
+            folded.count = count;
+            folded.stack = fmt::format("{}-{}", thread->comm, thread->tid);
+            // Call chain goes from leaf to root, folded stack from root to leaf
+            for (auto it = ips.rbegin(); it != ips.rend(); ++it) {
+                if (*it >= PERF_CONTEXT_MAX) {
+                    continue;
+                }
+                auto [name_it, inserted] = names.try_emplace(*it);
+                if (inserted) {
+                    name_it->second = symbolizer_.Symbolize(thread->tid, *it);
+                }
+                folded.stack += ';';
+                folded.stack += name_it->second;
+            }
+        }
+        thread->stacks.clear();
+    }
+
+    for (size_t i{}; i < folded_stacks.size(); i++) {
+        bool last_in_iter = i + 1 == folded_stacks.size();
+        for (auto const& acceptor: acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(folded_stacks[i], last_in_iter);
+        }
+    }
+    threads_.clear();
+}
+
+void ProfileManager::Drain() {
+    for (auto& thread: threads_) {
+        auto& stacks = thread->stacks;
+        thread->sampler.Drain([&stacks](int, int, std::span<const uint64_t> ips) {
+            // Look up by the view into the ring buffer, copy only new stacks
+            if (auto it = stacks.find(ips); it != stacks.end()) {
+                it->second++;
+            } else {
+                stacks.emplace(std::vector<uint64_t>{ips.begin(), ips.end()}, 1);
+            }
+        });
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef CPUSTATS_PROFILE_MANAGER_HPP
+#define CPUSTATS_PROFILE_MANAGER_HPP
+
+#include "manager_base.hpp"
+#include "../system/linux_perf.hpp"
+#include "../system/symbolizer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/** Collapsed stack in flamegraph format: "comm-tid;root;...;leaf" */
+struct FoldedStack {
+    int tid{};
+    std::string stack{};
+    uint64_t count{};
+};
+
+class FoldedStackAcceptor : public virtual Acceptor {
+public:
+    virtual ~FoldedStackAcceptor() = default;
+    virtual void Accept(FoldedStack const& value, bool last_in_iter = false) = 0;
+};
+
+
+/**
+ * Sampling profiler for tracked threads. Each thread gets a cpu-clock
+ * sampling perf event with call chains. Ring buffers are drained on each
+ * update into per-thread hash tables keyed by raw instruction pointers,
+ * and the stacks are symbolized only in `Finish()`.
+ */
+class ProfileManager : public Manager {
+public:
+    void add_pid(int pid) { pids_list_.push_back(pid); }
+    void set_frequency(int frequency) { frequency_ = frequency; }
+
+    void Init() override;
+    void Sample() override;
+    void Publish() override;
+    void Finish() override;
+    [[nodiscard]] Source source() const override { return Source::profile; }
+
+    void add_acceptor(std::shared_ptr<FoldedStackAcceptor> acceptor) {
+        acceptors_.push_back(std::move(acceptor));
+    }
+
+private:
+    struct StackHash {
+        using is_transparent = void;
+        size_t operator()(std::span<const uint64_t> ips) const;
+    };
+
+    struct StackEqual {
+        using is_transparent = void;
+        bool operator()(std::span<const uint64_t> a, std::span<const uint64_t> b) const;
+    };
+
+    using StackTable = std::unordered_map<std::vector<uint64_t>, uint64_t, StackHash, StackEqual>;
+
+    struct Thread {
+        int tid{};
+        std::string comm{};
+        PerfSampler sampler{};
+        StackTable stacks{};
+    };
+
+    std::vector<std::shared_ptr<FoldedStackAcceptor>> acceptors_{};
+    std::vector<int> pids_list_{};
+    int frequency_{99};
+    std::vector<std::unique_ptr<Thread>> threads_{};
+    Symbolizer symbolizer_{};
+
+    void Drain();
+};
+
+#endif //CPUSTATS_PROFILE_MANAGER_HPP
@@ -0,0 +1,116 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void Scheduler::set_interval(std::chrono::nanoseconds interval) {
+    period_ticks_.clear();
+    for (auto const& manager: managers_) {
+        auto ticks = std::llround(static_cast<double>(manager->period().count()) / static_cast<double>(interval.count()));
+        period_ticks_.push_back(static_cast<uint64_t>(std::max(ticks, 1ll)));
+    }
+    restart_ = true;
+}
+
+SourceSet Scheduler::Advance(uint64_t ticks) {
+    due_.clear();
+    if (restart_) {
+        wheel_.Clear();
+        for (size_t i{}; i < managers_.size(); i++) {
+            due_.push_back(i);
+            wheel_.Schedule(i, period_ticks_[i]);
+        }
+        restart_ = false;
+        return DueSources();
+    }
+    for (uint64_t tick{}; tick < ticks; tick++) {
+        // Managers due on a skipped tick are rescheduled from it, not from the current one
+        tick_due_.clear();
+        wheel_.Advance(tick_due_);
+        for (size_t i: tick_due_) {
+            wheel_.Schedule(i, period_ticks_[i]);
+            if (std::find(due_.begin(), due_.end(), i) == due_.end()) {
+                due_.push_back(i);
+            }
+        }
+    }
+    // Keep the order managers were added in, consumers may rely on it
+    std::sort(due_.begin(), due_.end());
+    return DueSources();
+}
+
+SourceSet Scheduler::DueAll() {
+    due_.clear();
+    for (size_t i{}; i < managers_.size(); i++) {
+        due_.push_back(i);
+    }
+    return DueSources();
+}
+
+SourceSet Scheduler::AddDue(Source source) {
+    for (size_t i{}; i < managers_.size(); i++) {
+        if (managers_[i]->source() == source && std::find(due_.begin(), due_.end(), i) == due_.end()) {
+            due_.push_back(i);
+        }
+    }
+    std::sort(due_.begin(), due_.end());
+    return DueSources();
+}
+
+void Scheduler::Update() {
+    if (proc_scan_) {
+        proc_scan_->Reset(DueSources());
+    }
+    tasks_.clear();
+    sample_times_.resize(due_.size());
+    for (size_t k{}; k < due_.size(); k++) {
+        tasks_.emplace_back([this, k]() {
+            auto& time = sample_times_[k];
+            time.start = std::chrono::steady_clock::now();
+            managers_[due_[k]]->Sample();
+            time.end = std::chrono::steady_clock::now();
+        });
+    }
+    // Returns when all managers are sampled, consumers never see a partial tick
+    pool_->Run(tasks_);
+
+    for (size_t i: due_) {
+        managers_[i]->Publish();
+    }
+    if (!acceptors_.empty()) {
+        auto tick = MeasureTick();
+        for (auto const& acceptor: acceptors_) {
+            if (!acceptor->is_enabled()) continue;
+            acceptor->Accept(tick, true);
+        }
+    }
+}
+
+SourceSet Scheduler::DueSources() const {
+    SourceSet sources{};
+    for (size_t i: due_) {
+        sources.Add(managers_[i]->source());
+    }
+    return sources;
+}
+
+TickStat Scheduler::MeasureTick() const {
+    TickStat tick{.refreshed = DueSources(), .sample_time = {}, .skew = {}};
+    if (sample_times_.empty()) {
+        return tick;
+    }
+    auto first_start = sample_times_.front().start;
+    auto last_end = sample_times_.front().end;
+    auto min_middle = std::chrono::steady_clock::time_point::max();
+    auto max_middle = std::chrono::steady_clock::time_point::min();
+    for (auto const& time: sample_times_) {
+        first_start = std::min(first_start, time.start);
+        last_end = std::max(last_end, time.end);
+        auto middle = time.start + (time.end - time.start) / 2;
+        min_middle = std::min(min_middle, middle);
+        max_middle = std::max(max_middle, middle);
+    }
+    tick.sample_time = last_end - first_start;
+    tick.skew = max_middle - min_middle;
+    return tick;
+}
@@ -0,0 +1,106 @@
+#ifndef CPUSTATS_SCHEDULER_HPP
+#define CPUSTATS_SCHEDULER_HPP
+
+#include "manager_base.hpp"
+#include "proc_scan.hpp"
+#include "../utility/timing_wheel.hpp"
+#include "../utility/worker_pool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Timing of a tick: managers sample concurrently, so the sources are
+ * taken at nearly the same moment unless one of them is slow to read.
+ */
+struct TickStat {
+    SourceSet refreshed;
+    std::chrono::nanoseconds sample_time;  // from the first Sample() start to the last one's end
+    std::chrono::nanoseconds skew;         // between the earliest and latest Sample() midpoints
+};
+
+class TickStatAcceptor : public virtual Acceptor {
+public:
+    virtual ~TickStatAcceptor() = default;
+    virtual void Accept(TickStat const& value, bool last_in_iter) = 0;
+};
+
+/**
+ * Calls managers that are due on a tick of the main loop.
+ *
+ * Manager periods are rounded to whole ticks (at least one), so a cheap
+ * source like /proc/stat can be read on every tick while a scan of all
+ * PIDs runs every few seconds. All managers are due on the first tick.
+ */
+class Scheduler {
+public:
+    void add_manager(std::shared_ptr<Manager> manager) {
+        managers_.push_back(std::move(manager));
+    }
+
+    void add_acceptor(std::shared_ptr<TickStatAcceptor> acceptor) {
+        acceptors_.push_back(std::move(acceptor));
+    }
+
+    [[nodiscard]] std::vector<std::shared_ptr<Manager>> const& managers() const { return managers_; }
+
+    /** Pass over /proc shared by managers, started anew on every tick */
+    void set_proc_scan(std::shared_ptr<ProcScan> proc_scan) { proc_scan_ = std::move(proc_scan); }
+
+    /** Sample due managers on that many threads besides the main loop one, zero samples them in turn */
+    void set_num_threads(size_t num_threads) { pool_ = std::make_unique<WorkerPool>(num_threads); }
+
+    /** Set the tick length, periods are recomputed and all managers are due on the next tick */
+    void set_interval(std::chrono::nanoseconds interval);
+
+    /**
+     * Advance by that many ticks, more than one when the timer expired
+     * again during a long iteration, so periods keep to their deadlines.
+     * Returns sources of the managers due on any of them.
+     */
+    SourceSet Advance(uint64_t ticks);
+
+    /** Mark all managers due without advancing, for samples taken between ticks */
+    SourceSet DueAll();
+
+    /** Mark no manager due, before AddDue() between ticks */
+    void ClearDue() { due_.clear(); }
+
+    /**
+     * Mark managers of the source due as well, without advancing, for
+     * samples of a single source taken between ticks (a PSI trigger)
+     */
+    SourceSet AddDue(Source source);
+
+    /**
+     * Sample managers found due by the last Advance() or DueAll() in
+     * parallel, then wait for all of them and publish their values in
+     * the order the managers were added.
+     */
+    void Update();
+
+private:
+    struct SampleTime {
+        std::chrono::steady_clock::time_point start{};
+        std::chrono::steady_clock::time_point end{};
+    };
+
+    std::vector<std::shared_ptr<Manager>> managers_{};
+    std::vector<std::shared_ptr<TickStatAcceptor>> acceptors_{};
+    std::shared_ptr<ProcScan> proc_scan_{};
+    std::vector<uint64_t> period_ticks_{};  // indexed as managers_
+    TimingWheel<size_t> wheel_{};
+    std::vector<size_t> due_{};
+    std::vector<size_t> tick_due_{};  // on one of the ticks Advance() steps over
+    bool restart_{true};
+    std::unique_ptr<WorkerPool> pool_{std::make_unique<WorkerPool>()};
+    std::vector<std::function<void()>> tasks_{};
+    std::vector<SampleTime> sample_times_{};  // indexed as due_
+
+    SourceSet DueSources() const;
+    TickStat MeasureTick() const;
+};
+
+#endif //CPUSTATS_SCHEDULER_HPP
@@ -0,0 +1,210 @@
+#include "backend_probe.hpp"
+#include "linux_perf.hpp"
+#include "proc_root.hpp"
+
+#include <fmt/format.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/perf_event.h>
+#include <linux/taskstats.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+constexpr int kCapNetAdmin = 12;
+constexpr int kCapSysAdmin = 21;
+constexpr int kCapPerfmon = 38;
+
+uint64_t ReadEffectiveCaps() {
+    std::istringstream ifs{ProcRoot::Instance().ReadProc("self/status").value_or("")};
+    std::string line{};
+    while (std::getline(ifs, line)) {
+        if (line.starts_with("CapEff:")) {
+            return std::strtoull(line.c_str() + 7, nullptr, 16);
+        }
+    }
+    return 0;
+}
+
+bool ProbeGetdents64() {
+    // Bad descriptor is checked after the syscall number
+    return ::syscall(SYS_getdents64, -1, nullptr, 0) < 0 && errno != ENOSYS;
+}
+
+bool ProbeIoUring() {
+#if defined(SYS_io_uring_setup) && __has_include(<linux/io_uring.h>)
+    // Setup may be denied by kernel.io_uring_disabled, so create a real ring
+    io_uring_params params{};
+    int fd = static_cast<int>(::syscall(SYS_io_uring_setup, 1, &params));
+    if (fd < 0) {
+        return false;
+    }
+    ::close(fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ProbePidfd() {
+#ifdef SYS_pidfd_open
+    int fd = static_cast<int>(::syscall(SYS_pidfd_open, ::getpid(), 0));
+    if (fd < 0) {
+        return false;
+    }
+    ::close(fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/** Resolve "TASKSTATS" generic netlink family */
+bool ProbeTaskstats() {
+    int fd = ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (fd < 0) {
+        return false;
+    }
+    struct {
+        nlmsghdr header;
+        genlmsghdr genl;
+        char attrs[64];
+    } request{};
+    auto *attr = reinterpret_cast<nlattr*>(request.attrs);
+    attr->nla_type = CTRL_ATTR_FAMILY_NAME;
+    attr->nla_len = NLA_HDRLEN + sizeof(TASKSTATS_GENL_NAME);
+    std::memcpy(request.attrs + NLA_HDRLEN, TASKSTATS_GENL_NAME, sizeof(TASKSTATS_GENL_NAME));
+    request.header.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_ALIGN(attr->nla_len));
+    request.header.nlmsg_type = GENL_ID_CTRL;
+    request.header.nlmsg_flags = NLM_F_REQUEST;
+    request.header.nlmsg_seq = 1;
+    request.genl.cmd = CTRL_CMD_GETFAMILY;
+    request.genl.version = 1;
+
+    sockaddr_nl addr{.nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 0};
+    bool available{false};
+    if (::sendto(fd, &request, request.header.nlmsg_len, 0,
+                 reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) >= 0) {
+        pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+        alignas(nlmsghdr) char response[4096];
+        if (::poll(&pfd, 1, 100) > 0) {
+            auto size = ::recv(fd, response, sizeof(response), 0);
+            auto const *header = reinterpret_cast<nlmsghdr const*>(response);
+            available = size >= static_cast<ssize_t>(sizeof(nlmsghdr)) && header->nlmsg_type != NLMSG_ERROR;
+        }
+    }
+    ::close(fd);
+    return available;
+}
+
+/** Subscribe to process events, needs CAP_NET_ADMIN */
+bool ProbeProcConnector() {
+    int fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd < 0) {
+        return false;
+    }
+    sockaddr_nl addr{.nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = CN_IDX_PROC};
+    bool available = ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(fd);
+    return available;
+}
+
+bool ProbePerfEvents() {
+    constexpr PerfEventSpec kTaskClock[] = {{PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}};
+    PerfEventGroup group{};
+    return group.Open(0, -1, kTaskClock) == 0;
+}
+
+const char *ToString(ProcListBackend backend) {
+    return backend == ProcListBackend::getdents ? "getdents" : "readdir";
+}
+
+const char *ToString(ProcReadBackend backend) {
+    return backend == ProcReadBackend::syscall ? "read" : "stream";
+}
+
+}
+
+BackendCapabilities ProbeBackends() {
+    BackendCapabilities caps{};
+    utsname uts{};
+    if (::uname(&uts) == 0) {
+        caps.kernel_release = uts.release;
+        std::sscanf(uts.release, "%d.%d", &caps.kernel_major, &caps.kernel_minor);
+    }
+    auto cap_eff = ReadEffectiveCaps();
+    caps.cap_net_admin = (cap_eff >> kCapNetAdmin) & 1;
+    caps.cap_sys_admin = (cap_eff >> kCapSysAdmin) & 1;
+    caps.cap_perfmon = (cap_eff >> kCapPerfmon) & 1;
+    caps.perf_event_paranoid = ReadPerfEventParanoid();
+
+    caps.getdents64 = ProbeGetdents64();
+    caps.io_uring = ProbeIoUring();
+    caps.taskstats = ProbeTaskstats();
+    caps.proc_connector = ProbeProcConnector();
+    caps.perf_events = ProbePerfEvents();
+    caps.pidfd = ProbePidfd();
+    return caps;
+}
+
+std::string BackendCapabilities::String() const {
+    auto yes_no = [](bool value) { return value ? "yes" : "no"; };
+    std::stringstream ss;
+    ss << "kernel: " << kernel_release << std::endl
+        << "capabilities: sys_admin " << yes_no(cap_sys_admin)
+        << ", net_admin " << yes_no(cap_net_admin)
+        << ", perfmon " << yes_no(cap_perfmon)
+        << ", perf_event_paranoid " << (perf_event_paranoid ? std::to_string(*perf_event_paranoid) : "?") << std::endl
+        << "available: getdents64 " << yes_no(getdents64)
+        << ", io_uring " << yes_no(io_uring)
+        << ", taskstats " << yes_no(taskstats)
+        << ", proc_connector " << yes_no(proc_connector)
+        << ", perf " << yes_no(perf_events)
+        << ", pidfd " << yes_no(pidfd) << std::endl;
+    return ss.str();
+}
+
+BackendSelection SelectBackends(BackendCapabilities const& caps) {
+    BackendSelection selection{};
+    selection.proc_list = caps.getdents64 ? ProcListBackend::getdents : ProcListBackend::filesystem;
+    selection.proc_read = ProcReadBackend::syscall;
+    return selection;
+}
+
+std::string BackendSelection::String() const {
+    return fmt::format("backends: list PIDs {}, read proc files {}\n", ToString(proc_list), ToString(proc_read));
+}
+
+bool OverrideBackends(std::string const& names, BackendSelection& selection) {
+    std::stringstream ss{names};
+    std::string name{};
+    while (std::getline(ss, name, ',')) {
+        if (name == "getdents") {
+            selection.proc_list = ProcListBackend::getdents;
+        } else if (name == "readdir") {
+            selection.proc_list = ProcListBackend::filesystem;
+        } else if (name == "read") {
+            selection.proc_read = ProcReadBackend::syscall;
+        } else if (name == "stream") {
+            selection.proc_read = ProcReadBackend::stream;
+        } else if (name != "auto") {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef CPUSTATS_BACKEND_PROBE_HPP
+#define CPUSTATS_BACKEND_PROBE_HPP
+
+#include "linux_proc.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+
+/**
+ * Kernel interfaces that may serve as data sources, probed once at
+ * startup. A feature is available if its syscall exists and the
+ * process has enough privileges to use it.
+ */
+struct BackendCapabilities {
+    std::string kernel_release{};
+    int kernel_major{};
+    int kernel_minor{};
+    bool cap_sys_admin{false};
+    bool cap_net_admin{false};
+    bool cap_perfmon{false};
+    std::optional<int> perf_event_paranoid{};
+
+    bool getdents64{false};
+    bool io_uring{false};
+    bool taskstats{false};
+    bool proc_connector{false};
+    bool perf_events{false};
+    bool pidfd{false};
+
+    [[nodiscard]] std::string String() const;
+};
+
+BackendCapabilities ProbeBackends();
+
+
+/** Backends chosen per data source */
+struct BackendSelection {
+    ProcListBackend proc_list{ProcListBackend::filesystem};
+    ProcReadBackend proc_read{ProcReadBackend::stream};
+
+    [[nodiscard]] std::string String() const;
+};
+
+/** Choose the fastest backends available */
+BackendSelection SelectBackends(BackendCapabilities const& caps);
+
+/**
+ * Apply `--backend` override: comma-separated names of backends
+ * ("getdents", "readdir" for listing PIDs, "read", "stream" for
+ * reading files), each replacing the choice for its data source.
+ * @return false if a name is unknown
+ */
+bool OverrideBackends(std::string const& names, BackendSelection& selection);
+
+#endif //CPUSTATS_BACKEND_PROBE_HPP
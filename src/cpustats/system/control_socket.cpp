@@ -0,0 +1,93 @@
+#include "control_socket.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Longer lines are not commands, the client is disconnected
+constexpr size_t kMaxLineSize = 4096;
+
+}
+
+ControlSocket::~ControlSocket() {
+    for (auto const& [fd, _]: clients_) {
+        ::close(fd);
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(path_.c_str());
+    }
+}
+
+bool ControlSocket::Open(std::string const& path) {
+    sockaddr_un addr{.sun_family = AF_UNIX, .sun_path = {}};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Control socket path is too long: " << path << "\n";
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "Error creating control socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    ::unlink(path.c_str());
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd_, 8) < 0) {
+        std::cerr << "Error listening on " << path << ": " << std::strerror(errno) << "\n";
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    path_ = path;
+    return true;
+}
+
+int ControlSocket::AcceptClient() {
+    int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0) {
+        clients_.try_emplace(fd);
+    }
+    return fd;
+}
+
+bool ControlSocket::ReadCommands(int client_fd, std::vector<std::string>& commands) {
+    auto& pending = clients_[client_fd];
+    char buf[1024];
+    while (true) {
+        auto n = ::read(client_fd, buf, sizeof(buf));
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        pending.append(buf, n);
+        size_t pos{};
+        for (auto eol = pending.find('\n'); eol != std::string::npos; eol = pending.find('\n', pos)) {
+            commands.push_back(pending.substr(pos, eol - pos));
+            pos = eol + 1;
+        }
+        pending.erase(0, pos);
+        if (pending.size() > kMaxLineSize) {
+            return false;
+        }
+    }
+}
+
+void ControlSocket::Reply(int client_fd, std::string const& line) const {
+    auto message = line + "\n";
+    // Replies are short, a client that does not read them loses them
+    [[maybe_unused]] auto _ = ::send(client_fd, message.data(), message.size(), MSG_NOSIGNAL);
+}
+
+void ControlSocket::CloseClient(int client_fd) {
+    clients_.erase(client_fd);
+    ::close(client_fd);
+}
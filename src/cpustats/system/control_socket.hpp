@@ -0,0 +1,49 @@
+#ifndef CPUSTATS_CONTROL_SOCKET_HPP
+#define CPUSTATS_CONTROL_SOCKET_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Unix-domain stream socket accepting text commands, one per line,
+ * e.g. `echo "add-pid 1234" | socat - UNIX-CONNECT:/run/cpustats.sock`.
+ * Every command is answered with a single line.
+ *
+ * All descriptors are non-blocking and are meant to be watched by an
+ * EventLoop: the listening one (`fd()`) and every accepted client.
+ */
+class ControlSocket {
+public:
+    ControlSocket() = default;
+    ~ControlSocket();
+
+    ControlSocket(ControlSocket const&) = delete;
+    ControlSocket& operator=(ControlSocket const&) = delete;
+
+    /** Listen on the path, replacing a stale socket file */
+    bool Open(std::string const& path);
+
+    /** Accept a pending connection, returns the client descriptor or -1 */
+    int AcceptClient();
+
+    /**
+     * Read available input of the client and append complete lines to
+     * `commands`.
+     * @return false if the client disconnected, it must be closed then
+     */
+    bool ReadCommands(int client_fd, std::vector<std::string>& commands);
+
+    void Reply(int client_fd, std::string const& line) const;
+    void CloseClient(int client_fd);
+
+    [[nodiscard]] bool is_client(int fd) const { return clients_.contains(fd); }
+    [[nodiscard]] int fd() const { return listen_fd_; }
+
+private:
+    int listen_fd_{-1};
+    std::string path_{};
+    std::unordered_map<int, std::string> clients_{};  // fd -> incomplete line
+};
+
+#endif //CPUSTATS_CONTROL_SOCKET_HPP
@@ -0,0 +1,33 @@
+#include "cpu_mask.hpp"
+
+#include <fmt/format.h>
+#include <sched.h>
+
+std::string CpuMask::ToString() const {
+    std::string result{};
+    int num_cpus = static_cast<int>(words_.size() * 64);
+    for (int cpu{}; cpu < num_cpus; cpu++) {
+        if (!Test(cpu)) continue;
+        int last = cpu;
+        while (last + 1 < num_cpus && Test(last + 1)) last++;
+        if (!result.empty()) result += ',';
+        result += last > cpu ? fmt::format("{}-{}", cpu, last) : fmt::format("{}", cpu);
+        cpu = last;
+    }
+    return result;
+}
+
+std::optional<CpuMask> ReadThreadAffinity(int tid) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(tid, sizeof(set), &set) != 0) {
+        return std::nullopt;
+    }
+    CpuMask mask{};
+    for (int cpu{}; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            mask.Set(cpu);
+        }
+    }
+    return mask;
+}
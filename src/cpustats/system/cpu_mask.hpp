@@ -0,0 +1,55 @@
+#ifndef CPUSTATS_CPU_MASK_HPP
+#define CPUSTATS_CPU_MASK_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Set of CPUs as a bitset, sized to the highest CPU in the set
+ * (one word for up to 64 CPUs).
+ */
+class CpuMask {
+public:
+    CpuMask() = default;
+    explicit CpuMask(std::vector<int> const& cpus) {
+        for (int cpu: cpus) Set(cpu);
+    }
+
+    void Set(int cpu) {
+        if (cpu < 0) return;
+        size_t word = cpu / 64;
+        if (word >= words_.size()) {
+            words_.resize(word + 1);
+        }
+        words_[word] |= uint64_t{1} << (cpu % 64);
+    }
+
+    [[nodiscard]] bool Test(int cpu) const {
+        if (cpu < 0) return false;
+        size_t word = cpu / 64;
+        return word < words_.size() && (words_[word] >> (cpu % 64)) & 1;
+    }
+
+    [[nodiscard]] bool empty() const {
+        for (auto word: words_) {
+            if (word) return false;
+        }
+        return true;
+    }
+
+    /** Format in kernel CPU list format, e.g. "0-3,8" */
+    [[nodiscard]] std::string ToString() const;
+
+private:
+    std::vector<uint64_t> words_{};
+};
+
+/**
+ * Read CPU affinity of the thread with `sched_getaffinity()`.
+ * Returns nullopt if the thread does not exist.
+ */
+std::optional<CpuMask> ReadThreadAffinity(int tid);
+
+#endif //CPUSTATS_CPU_MASK_HPP
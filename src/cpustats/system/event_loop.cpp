@@ -0,0 +1,66 @@
+#include "event_loop.hpp"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+EventLoop::~EventLoop() {
+    if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    if (wakeup_fd_ >= 0) ::close(wakeup_fd_);
+}
+
+bool EventLoop::Open() {
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ < 0 || wakeup_fd_ < 0) {
+        std::cerr << "Error creating event loop: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return Add(wakeup_fd_);
+}
+
+bool EventLoop::Add(int fd) {
+    epoll_event event{.events = EPOLLIN, .data = {.fd = fd}};
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        std::cerr << "Error adding descriptor to event loop: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+void EventLoop::Remove(int fd) {
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+std::vector<int> const& EventLoop::Wait() {
+    epoll_event events[16];
+    int n;
+    while ((n = ::epoll_wait(epoll_fd_, events, std::size(events), -1)) < 0) {
+        if (errno != EINTR) {
+            std::cerr << "Event loop wait failed: " << std::strerror(errno) << "\n";
+            n = 0;
+            break;
+        }
+    }
+    ready_.clear();
+    for (int i{}; i < n; i++) {
+        int fd = events[i].data.fd;
+        if (fd == wakeup_fd_) {
+            uint64_t value{};
+            [[maybe_unused]] auto _ = ::read(wakeup_fd_, &value, sizeof(value));
+        }
+        ready_.push_back(fd);
+    }
+    return ready_;
+}
+
+void EventLoop::Wakeup() const {
+    uint64_t value{1};
+    // Nothing to do on error: the counter is already non-zero and the waiter is woken anyway
+    [[maybe_unused]] auto _ = ::write(wakeup_fd_, &value, sizeof(value));
+}
@@ -0,0 +1,45 @@
+#ifndef CPUSTATS_EVENT_LOOP_HPP
+#define CPUSTATS_EVENT_LOOP_HPP
+
+#include <vector>
+
+/**
+ * Single epoll instance waiting for readable descriptors: the sampling
+ * timer, signals, control connections and the wakeup eventfd.
+ */
+class EventLoop {
+public:
+    EventLoop() = default;
+    ~EventLoop();
+
+    EventLoop(EventLoop const&) = delete;
+    EventLoop& operator=(EventLoop const&) = delete;
+
+    /** Create the epoll instance and the wakeup eventfd */
+    bool Open();
+
+    /** Watch the descriptor for input */
+    bool Add(int fd);
+    /** Stop watching the descriptor, before it is closed */
+    void Remove(int fd);
+
+    /**
+     * Block until some descriptors are readable, retrying on EINTR.
+     * `Wakeup()` is reported as `wakeup_fd()`, already drained.
+     *
+     * @return readable descriptors, valid until the next call
+     */
+    std::vector<int> const& Wait();
+
+    /** Interrupt `Wait()` from another thread, async-signal-safe */
+    void Wakeup() const;
+
+    [[nodiscard]] int wakeup_fd() const { return wakeup_fd_; }
+
+private:
+    int epoll_fd_{-1};
+    int wakeup_fd_{-1};
+    std::vector<int> ready_{};
+};
+
+#endif //CPUSTATS_EVENT_LOOP_HPP
@@ -0,0 +1,67 @@
+#include "interval_timer.hpp"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+namespace {
+
+constexpr int64_t kNanosPerSecond = 1'000'000'000;
+
+int64_t ToNanos(timespec const& ts) {
+    return static_cast<int64_t>(ts.tv_sec) * kNanosPerSecond + ts.tv_nsec;
+}
+
+timespec ToTimespec(int64_t ns) {
+    return {.tv_sec = static_cast<time_t>(ns / kNanosPerSecond), .tv_nsec = static_cast<long>(ns % kNanosPerSecond)};
+}
+
+}
+
+IntervalTimer::~IntervalTimer() {
+    if (timer_fd_ >= 0) ::close(timer_fd_);
+}
+
+bool IntervalTimer::Open() {
+    timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timer_fd_ < 0) {
+        std::cerr << "Error creating interval timer: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool IntervalTimer::Start(std::chrono::nanoseconds interval, bool align_to_wall_clock) {
+    timespec monotonic{};
+    timespec realtime{};
+    ::clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    ::clock_gettime(CLOCK_REALTIME, &realtime);
+    auto interval_ns = static_cast<int64_t>(interval.count());
+    // Distance to the first deadline
+    auto offset_ns = interval_ns;
+    if (align_to_wall_clock) {
+        offset_ns = interval_ns - ToNanos(realtime) % interval_ns;
+    }
+    itimerspec spec{
+        .it_interval = ToTimespec(interval_ns),
+        .it_value = ToTimespec(ToNanos(monotonic) + offset_ns)
+    };
+    if (::timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        std::cerr << "Error arming interval timer: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+uint64_t IntervalTimer::ReadTicks() {
+    uint64_t expirations{};
+    if (::read(timer_fd_, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return 0;
+    }
+    missed_ticks_ += expirations - 1;
+    return expirations;
+}
@@ -0,0 +1,53 @@
+#ifndef CPUSTATS_INTERVAL_TIMER_HPP
+#define CPUSTATS_INTERVAL_TIMER_HPP
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Periodic ticks on absolute `CLOCK_MONOTONIC` deadlines (timerfd).
+ *
+ * Deadlines are fixed when the timer is started, so the time spent
+ * between ticks does not shift the following ones. Ticks that were
+ * missed because an iteration took longer than the interval are
+ * skipped and counted, not caught up.
+ *
+ * The descriptor becomes readable on every tick, so the timer is
+ * waited for together with other sources (see EventLoop).
+ *
+ * When aligned, deadlines fall on wall-clock multiples of the interval
+ * (e.g. every whole second), so samples taken on different hosts with
+ * synchronized clocks line up.
+ */
+class IntervalTimer {
+public:
+    IntervalTimer() = default;
+    ~IntervalTimer();
+
+    IntervalTimer(IntervalTimer const&) = delete;
+    IntervalTimer& operator=(IntervalTimer const&) = delete;
+
+    /** Create the descriptor, the timer is disarmed */
+    bool Open();
+
+    /**
+     * Arm the timer, the first tick comes after one interval (or at the
+     * next boundary). May be called again to change the interval.
+     */
+    bool Start(std::chrono::nanoseconds interval, bool align_to_wall_clock);
+
+    /**
+     * Acknowledge ticks once the descriptor is readable.
+     * @return number of deadlines passed since the previous call, 0 if none
+     */
+    uint64_t ReadTicks();
+
+    [[nodiscard]] int fd() const { return timer_fd_; }
+    [[nodiscard]] uint64_t missed_ticks() const { return missed_ticks_; }
+
+private:
+    int timer_fd_{-1};
+    uint64_t missed_ticks_{};
+};
+
+#endif //CPUSTATS_INTERVAL_TIMER_HPP
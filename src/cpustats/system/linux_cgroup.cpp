@@ -0,0 +1,154 @@
+#include "linux_cgroup.hpp"
+#include "linux_sysfs.hpp"
+#include "proc_root.hpp"
+
+#include <sched.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+bool ParseCgroupCpuStat(const char *s, CgroupCpuStatValues& values) {
+    /*
+     * cpu.stat format, one "key value" pair per line:
+     * usage_usec 139670009
+     * user_usec 122540599
+     * system_usec 17129410
+     * nr_periods 0
+     * nr_throttled 0
+     * throttled_usec 0
+     */
+    struct Field {
+        const char *key;
+        size_t key_len;
+        uint64_t *value;
+    };
+    const Field fields[] = {
+            {"usage_usec", 10, &values.usage_usec},
+            {"user_usec", 9, &values.user_usec},
+            {"system_usec", 11, &values.system_usec},
+            {"nr_periods", 10, &values.nr_periods},
+            {"nr_throttled", 12, &values.nr_throttled},
+            {"throttled_usec", 14, &values.throttled_usec},
+    };
+    bool has_usage{false};
+    while (*s) {
+        for (auto const& field: fields) {
+            if (std::strncmp(s, field.key, field.key_len) == 0 && s[field.key_len] == ' ') {
+                *field.value = std::strtoull(s + field.key_len + 1, nullptr, 10);
+                has_usage = has_usage || field.value == &values.usage_usec;
+                break;
+            }
+        }
+        const char *eol = std::strchr(s, '\n');
+        if (!eol) break;
+        s = eol + 1;
+    }
+    return has_usage;
+}
+
+bool ParseCgroupPopulated(const char *s) {
+    const char *populated = std::strstr(s, "populated ");
+    return populated && populated[10] == '1';
+}
+
+std::vector<std::string> ListCgroupTree(std::string const& root) {
+    std::vector<std::string> result{root};
+    std::error_code ec{};
+    auto options = fs::directory_options::skip_permission_denied;
+    for (fs::recursive_directory_iterator it{root, options, ec}, end{}; !ec && it != end; it.increment(ec)) {
+        if (it->is_directory(ec)) {
+            result.push_back(it->path().string());
+        }
+    }
+    if (ec) {
+        std::cerr << "Error listing cgroups under " << root << ": " << ec.message() << "\n";
+    }
+    return result;
+}
+
+std::string GetSelfCgroupPath() {
+    // Unified hierarchy line has the form "0::/path"
+    std::istringstream ifs{ProcRoot::Instance().ReadProc("self/cgroup").value_or("")};
+    std::string line{};
+    std::string relative{};
+    while (std::getline(ifs, line)) {
+        if (line.starts_with("0::")) {
+            relative = line.substr(3);
+            break;
+        }
+    }
+    if (relative.empty()) {
+        return {};
+    }
+    // Unified mount in pure v2 mode, then in hybrid mode
+    auto const& sys_path = ProcRoot::Instance().sys_path();
+    for (auto const& mount: {sys_path + "/fs/cgroup", sys_path + "/fs/cgroup/unified"}) {
+        std::error_code ec{};
+        if (fs::exists(fs::path{mount} / "cgroup.controllers", ec)) {
+            return relative == "/" ? mount : mount + relative;
+        }
+    }
+    return {};
+}
+
+std::vector<int> ReadCgroupEffectiveCpus(std::string const& path) {
+    for (fs::path dir{path}; !dir.empty() && dir != dir.root_path(); dir = dir.parent_path()) {
+        std::ifstream ifs{dir / "cpuset.cpus.effective"};
+        if (std::string line; std::getline(ifs, line)) {
+            auto cpus = ParseCpuList(line.c_str());
+            if (!cpus.empty()) {
+                return cpus;
+            }
+        }
+    }
+    std::vector<int> cpus{};
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int cpu{}; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &mask)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+std::optional<double> ReadCgroupCpuLimit(std::string const& path) {
+    /*
+     * cpu.max format: "$MAX $PERIOD", where $MAX is "max" if not limited
+     */
+    std::optional<double> limit{};
+    for (fs::path dir{path}; !dir.empty() && dir != dir.root_path(); dir = dir.parent_path()) {
+        std::ifstream ifs{dir / "cpu.max"};
+        std::string quota{};
+        double period{};
+        if (!(ifs >> quota >> period) || quota == "max" || period <= 0) {
+            continue;
+        }
+        double cpus = std::strtod(quota.c_str(), nullptr) / period;
+        if (!limit || cpus < *limit) {
+            limit = cpus;
+        }
+    }
+    return limit;
+}
+
+std::vector<int> ReadCgroupThreads(std::string const& path) {
+    std::ifstream ifs{path + "/cgroup.threads"};
+    if (ifs.fail()) {
+        std::cerr << "Error opening " << path << "/cgroup.threads\n";
+        return {};
+    }
+    std::vector<int> tids{};
+    for (int tid; ifs >> tid; ) {
+        tids.push_back(tid);
+    }
+    return tids;
+}
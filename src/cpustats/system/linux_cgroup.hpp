@@ -0,0 +1,62 @@
+#ifndef CPUSTATS_LINUX_CGROUP_HPP
+#define CPUSTATS_LINUX_CGROUP_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+/** Cumulative counters from cgroup v2 `cpu.stat` */
+struct CgroupCpuStatValues {
+    uint64_t usage_usec{};
+    uint64_t user_usec{};
+    uint64_t system_usec{};
+    uint64_t nr_periods{};
+    uint64_t nr_throttled{};
+    uint64_t throttled_usec{};
+};
+
+
+/**
+ * Parse `cpu.stat` content. Throttling counters are present only
+ * when the cpu controller is enabled and are left zero otherwise.
+ * @return false if `usage_usec` is missing
+ */
+bool ParseCgroupCpuStat(const char *s, CgroupCpuStatValues& values);
+
+/**
+ * Parse `populated` field of `cgroup.events` content.
+ */
+bool ParseCgroupPopulated(const char *s);
+
+/**
+ * List the given cgroup directory and all its descendants.
+ */
+std::vector<std::string> ListCgroupTree(std::string const& root);
+
+/**
+ * Read IDs of all threads in the cgroup from `<path>/cgroup.threads`.
+ */
+std::vector<int> ReadCgroupThreads(std::string const& path);
+
+/**
+ * Find cgroup v2 directory of the calling process using `/proc/self/cgroup`.
+ * Returns an empty string if the unified hierarchy is not mounted.
+ */
+std::string GetSelfCgroupPath();
+
+/**
+ * Read `cpuset.cpus.effective` of the cgroup. If the cpuset controller
+ * is not enabled in the cgroup, the nearest ancestor having it is used,
+ * and the process affinity mask is the last resort.
+ */
+std::vector<int> ReadCgroupEffectiveCpus(std::string const& path);
+
+/**
+ * Compute the strictest `cpu.max` limit of the cgroup and its ancestors
+ * in CPUs (quota / period). Returns nullopt if no limit is set.
+ */
+std::optional<double> ReadCgroupCpuLimit(std::string const& path);
+
+#endif //CPUSTATS_LINUX_CGROUP_HPP
@@ -0,0 +1,193 @@
+#include "linux_perf.hpp"
+#include "proc_root.hpp"
+
+#include <fmt/format.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+int PerfEventOpen(perf_event_attr& attr, int pid, int cpu, int group_fd) {
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, pid, cpu, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+
+}
+
+PerfEventGroup::~PerfEventGroup() {
+    Close();
+}
+
+PerfEventGroup::PerfEventGroup(PerfEventGroup&& other) noexcept
+: fds_(std::move(other.fds_)), slots_(std::move(other.slots_)) {
+    other.fds_.clear();
+    other.slots_.clear();
+}
+
+PerfEventGroup& PerfEventGroup::operator=(PerfEventGroup&& other) noexcept {
+    if (this != &other) {
+        Close();
+        fds_ = std::move(other.fds_);
+        slots_ = std::move(other.slots_);
+        other.fds_.clear();
+        other.slots_.clear();
+    }
+    return *this;
+}
+
+int PerfEventGroup::Open(int pid, int cpu, std::span<const PerfEventSpec> events) {
+    Close();
+    slots_.assign(events.size(), -1);
+    for (size_t i{}; i < events.size(); i++) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_hv = 1;
+        int group_fd = fds_.empty() ? -1 : fds_.front();
+        int fd = PerfEventOpen(attr, pid, cpu, group_fd);
+        // Unprivileged users may count only user space of own tasks
+        if (fd < 0 && (errno == EACCES || errno == EPERM) && pid >= 0) {
+            attr.exclude_kernel = 1;
+            fd = PerfEventOpen(attr, pid, cpu, group_fd);
+        }
+        if (fd < 0) {
+            int error = errno;
+            if (i == 0 || !events[i].optional) {
+                Close();
+                return error;
+            }
+            continue;
+        }
+        slots_[i] = static_cast<int>(fds_.size());
+        fds_.push_back(fd);
+    }
+    return 0;
+}
+
+void PerfEventGroup::Close() {
+    for (int fd: fds_) {
+        close(fd);
+    }
+    fds_.clear();
+    slots_.clear();
+}
+
+bool PerfEventGroup::Read(PerfGroupValues& values) const {
+    if (fds_.empty()) {
+        return false;
+    }
+    // Layout: nr, time_enabled, time_running, value[nr]
+    uint64_t buf[3 + 16];
+    auto size = (3 + fds_.size()) * sizeof(uint64_t);
+    if (fds_.size() > 16 || read(fds_.front(), buf, size) != static_cast<ssize_t>(size)) {
+        return false;
+    }
+    values.time_enabled = buf[1];
+    values.time_running = buf[2];
+    double scale = values.time_running > 0 && values.time_running < values.time_enabled
+            ? static_cast<double>(values.time_enabled) / static_cast<double>(values.time_running)
+            : 1.0;
+    values.values.resize(slots_.size());
+    for (size_t i{}; i < slots_.size(); i++) {
+        if (slots_[i] < 0) {
+            values.values[i] = std::nullopt;
+        } else {
+            values.values[i] = static_cast<uint64_t>(static_cast<double>(buf[3 + slots_[i]]) * scale);
+        }
+    }
+    return true;
+}
+
+PerfSampler::~PerfSampler() {
+    Close();
+}
+
+int PerfSampler::Open(int tid, int frequency, size_t data_pages) {
+    Close();
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_CPU_CLOCK;
+    attr.freq = 1;
+    attr.sample_freq = frequency;
+    attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+    attr.exclude_hv = 1;
+    fd_ = PerfEventOpen(attr, tid, -1, -1);
+    if (fd_ < 0 && (errno == EACCES || errno == EPERM)) {
+        // Unprivileged users may sample only user space
+        attr.exclude_kernel = 1;
+        attr.exclude_callchain_kernel = 1;
+        fd_ = PerfEventOpen(attr, tid, -1, -1);
+    }
+    if (fd_ < 0) {
+        return errno;
+    }
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    data_size_ = data_pages * page_size;
+    mmap_size_ = data_size_ + page_size;
+    mmap_base_ = mmap(nullptr, mmap_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mmap_base_ == MAP_FAILED) {
+        int error = errno;
+        mmap_base_ = nullptr;
+        Close();
+        return error;
+    }
+    data_ = static_cast<const char *>(mmap_base_) + page_size;
+    return 0;
+}
+
+void PerfSampler::Close() {
+    if (mmap_base_) {
+        munmap(mmap_base_, mmap_size_);
+        mmap_base_ = nullptr;
+        data_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+uint64_t PerfSampler::LoadHead() const {
+    auto const *page = static_cast<const perf_event_mmap_page *>(mmap_base_);
+    return __atomic_load_n(&page->data_head, __ATOMIC_ACQUIRE);
+}
+
+void PerfSampler::StoreTail(uint64_t tail) {
+    auto *page = static_cast<perf_event_mmap_page *>(mmap_base_);
+    __atomic_store_n(&page->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+std::optional<int> ReadPerfEventParanoid() {
+    std::istringstream ifs{ProcRoot::Instance().ReadProc("sys/kernel/perf_event_paranoid").value_or("")};
+    int value{};
+    if (!(ifs >> value)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::string PerfErrorMessage(int error) {
+    if (error == EACCES || error == EPERM) {
+        auto paranoid = ReadPerfEventParanoid();
+        return fmt::format(
+                "access denied by perf_event_paranoid = {}, run as root, "
+                "grant CAP_PERFMON or lower the setting",
+                paranoid ? std::to_string(*paranoid) : "?");
+    }
+    if (error == ENOSYS) {
+        return "perf events are not supported by the kernel";
+    }
+    if (error == ENOENT || error == EOPNOTSUPP) {
+        return "event is not supported on this system";
+    }
+    return std::strerror(error);
+}
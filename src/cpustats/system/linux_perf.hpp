@@ -0,0 +1,173 @@
+#ifndef CPUSTATS_LINUX_PERF_HPP
+#define CPUSTATS_LINUX_PERF_HPP
+
+#include <linux/perf_event.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+
+struct PerfEventSpec {
+    uint32_t type{};
+    uint64_t config{};
+    bool optional{false};  // group is usable without this event
+};
+
+
+/**
+ * Values of a counting event group, scaled by time_enabled / time_running
+ * when the group was multiplexed. Indexed as the specs passed to Open();
+ * events that could not be opened have no value.
+ */
+struct PerfGroupValues {
+    uint64_t time_enabled{};
+    uint64_t time_running{};
+    std::vector<std::optional<uint64_t>> values{};
+
+    /** Increase of the event counter since `prev`, 0 if unknown */
+    [[nodiscard]] uint64_t Delta(PerfGroupValues const& prev, size_t index) const {
+        auto const& curr_value = values.at(index);
+        auto const& prev_value = prev.values.at(index);
+        return curr_value && prev_value && *curr_value > *prev_value ? *curr_value - *prev_value : 0;
+    }
+};
+
+
+/**
+ * Group of counting perf events read with a single `read()`.
+ * The first event is the group leader and is always required.
+ */
+class PerfEventGroup {
+public:
+    PerfEventGroup() = default;
+    ~PerfEventGroup();
+
+    PerfEventGroup(PerfEventGroup const&) = delete;
+    PerfEventGroup& operator=(PerfEventGroup const&) = delete;
+    PerfEventGroup(PerfEventGroup&& other) noexcept;
+    PerfEventGroup& operator=(PerfEventGroup&& other) noexcept;
+
+    /**
+     * Open the group for the task `pid` on any CPU (cpu = -1), or for
+     * all tasks on the CPU (pid = -1). Events are enabled immediately.
+     *
+     * @return 0 on success, or errno of the first required event failure
+     */
+    int Open(int pid, int cpu, std::span<const PerfEventSpec> events);
+    void Close();
+
+    bool Read(PerfGroupValues& values) const;
+
+    [[nodiscard]] bool is_open() const { return !fds_.empty(); }
+    [[nodiscard]] bool has_event(size_t index) const {
+        return index < slots_.size() && slots_[index] >= 0;
+    }
+
+private:
+    std::vector<int> fds_{};    // opened events, leader first
+    std::vector<int> slots_{};  // position in group read by spec index, -1 if not opened
+};
+
+
+/**
+ * Sampling cpu-clock perf event with call chains, attached to a single
+ * thread. Samples are read in place from the mmap'ed ring buffer.
+ */
+class PerfSampler {
+public:
+    PerfSampler() = default;
+    ~PerfSampler();
+
+    PerfSampler(PerfSampler const&) = delete;
+    PerfSampler& operator=(PerfSampler const&) = delete;
+
+    /**
+     * @param tid thread to sample
+     * @param frequency samples per second
+     * @param data_pages ring buffer size in pages, must be a power of two
+     * @return 0 on success, or errno
+     */
+    int Open(int tid, int frequency, size_t data_pages = 8);
+    void Close();
+
+    [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+    [[nodiscard]] uint64_t lost() const { return lost_; }
+
+    /**
+     * Call `callback(pid, tid, std::span<const uint64_t> ips)` for each
+     * sample in the ring buffer and release the consumed space. Only
+     * records wrapping around the buffer end are copied.
+     */
+    template<typename Callback>
+    void Drain(Callback&& callback);
+
+private:
+    int fd_{-1};
+    void *mmap_base_{nullptr};
+    size_t mmap_size_{};
+    const char *data_{nullptr};
+    size_t data_size_{};
+    uint64_t lost_{};
+    std::vector<uint64_t> wrap_buf_{};
+
+    [[nodiscard]] uint64_t LoadHead() const;
+    void StoreTail(uint64_t tail);
+};
+
+
+/** Read `/proc/sys/kernel/perf_event_paranoid`, nullopt if perf is not supported */
+std::optional<int> ReadPerfEventParanoid();
+
+/** Human-readable explanation of perf_event_open() failure */
+std::string PerfErrorMessage(int error);
+
+
+template<typename Callback>
+void PerfSampler::Drain(Callback&& callback) {
+    /*
+     * Sample record layout for PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN:
+     * perf_event_header, u32 pid, u32 tid, u64 nr, u64 ips[nr]
+     */
+    using Header = perf_event_header;
+    if (fd_ < 0) {
+        return;
+    }
+    uint64_t head = LoadHead();
+    uint64_t tail = static_cast<const perf_event_mmap_page *>(mmap_base_)->data_tail;
+    while (tail < head) {
+        size_t offset = tail % data_size_;
+        Header header{};
+        std::memcpy(&header, data_ + offset, sizeof(header));
+        if (header.size < sizeof(Header)) {
+            break;
+        }
+        const char *record = data_ + offset;
+        if (offset + header.size > data_size_) {
+            // Record wraps around the buffer end, copy it to make contiguous
+            wrap_buf_.resize((header.size + 7) / 8);
+            auto *dst = reinterpret_cast<char *>(wrap_buf_.data());
+            size_t first = data_size_ - offset;
+            std::memcpy(dst, data_ + offset, first);
+            std::memcpy(dst + first, data_, header.size - first);
+            record = dst;
+        }
+        if (header.type == PERF_RECORD_SAMPLE && header.size >= sizeof(Header) + 16) {
+            auto const *fields = reinterpret_cast<const uint32_t *>(record + sizeof(Header));
+            auto const *nr = reinterpret_cast<const uint64_t *>(record + sizeof(Header) + 8);
+            auto n_ips = std::min<uint64_t>(*nr, (header.size - sizeof(Header) - 16) / 8);
+            callback(static_cast<int>(fields[0]), static_cast<int>(fields[1]),
+                     std::span<const uint64_t>{nr + 1, static_cast<size_t>(n_ips)});
+        } else if (header.type == PERF_RECORD_LOST && header.size >= sizeof(Header) + 16) {
+            lost_ += reinterpret_cast<const uint64_t *>(record + sizeof(Header))[1];
+        }
+        tail += header.size;
+    }
+    StoreTail(tail);
+}
+
+#endif //CPUSTATS_LINUX_PERF_HPP
@@ -1,11 +1,20 @@
 #include "linux_proc.hpp"
+#include "proc_root.hpp"
 #include "../utility/strings.hpp"
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <fmt/format.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 
 namespace fs = std::filesystem;
@@ -15,12 +24,12 @@ int GetCpuCount() {
 }
 
 std::vector<CpuInfo> LoadProcCpuInfo() {
-    std::ifstream ifs;
-    ifs.open("/proc/cpuinfo", std::ios::in);
-    if (ifs.fail()) {
+    auto content = ProcRoot::Instance().ReadProc("cpuinfo");
+    if (!content) {
         std::cerr << "Error opening /proc/cpuinfo\n";
         return {};
     }
+    std::istringstream ifs{*content};
     std::string line{};
     std::vector<CpuInfo> result;
     while (std::getline(ifs, line)) {
@@ -51,11 +60,12 @@ std::vector<CpuInfo> LoadProcCpuInfo() {
 }
 
 void ReadProcStat(std::vector<CpuStat>& cpus) {
-    std::ifstream ifs;
-    ifs.open("/proc/stat", std::ios::in);
+    std::istringstream ifs{ProcRoot::Instance().ReadProc("stat").value_or("")};
     std::string line{};
-    int n_cpus{0};
-    while (std::getline(ifs, line) && n_cpus < cpus.size()) {
+    // Both /proc/stat lines and `cpus` are sorted by CPU index, so the
+    // slot of each line is found by walking `cpus` forward.
+    size_t slot{0};
+    while (std::getline(ifs, line) && slot < cpus.size()) {
         auto cs = line.c_str();
         /*
          * CPU core line format:
@@ -66,47 +76,133 @@ void ReadProcStat(std::vector<CpuStat>& cpus) {
             continue;
         }
         // Ok, the line is correct. Extract cpu index first.
-        size_t index{};
-        if (std::sscanf(cs, "cpu%lu", &index) != 1 || index >= cpus.size()) {
+        int index{};
+        if (std::sscanf(cs, "cpu%d", &index) != 1) {
             continue;
         }
-        CpuStat& cpu = cpus[index];
+        while (slot < cpus.size() && cpus[slot].cpu < index) {
+            slot++;
+        }
+        if (slot == cpus.size() || cpus[slot].cpu != index) {
+            continue;
+        }
+        CpuStat& cpu = cpus[slot];
         int ret = std::sscanf(
-                cs, "cpu%lu %d %d %d %d %d %d %d %d %d %d",
+                cs, "cpu%d %d %d %d %d %d %d %d %d %d %d",
                 &index, cpu.user(), cpu.nice(), cpu.system(), cpu.idle(),
                 cpu.iowait(), cpu.irq(), cpu.softirq(), cpu.steal(),
                 cpu.guest(), cpu.guest_nice());
         if (ret != 11) {
             continue;
         } else {
-            n_cpus++;
+            slot++;
         }
     }
 }
 
+namespace {
+
+ProcListBackend proc_list_backend{ProcListBackend::filesystem};
+ProcReadBackend proc_read_backend{ProcReadBackend::stream};
+
+void ParseProcPidStat(const char *line, PidStat& stat) {
+    // Command name (column #1) may contain spaces and parentheses,
+    // so the state column is located after the last ')'
+    const char *s = std::strrchr(line, ')');
+    if (const char *comm = std::strchr(line, '('); comm && s && comm < s) {
+        auto len = std::min<size_t>(s - comm - 1, stat.comm.size() - 1);
+        std::memcpy(stat.comm.data(), comm + 1, len);
+        stat.comm[len] = '\0';
+    }
+    s = s ? ToNextWord(s, 1) : "";
+    if (!*s) {
+        std::cerr << "bad line in /proc/" << stat.pid << "/stat"
+                  << ": missing state column #2" << std::endl;
+        stat.state = PidStat::State::not_found;
+        return;
+    }
+    stat.state = PidStateFromChar(*s);
+    s = ToNextWord(s, 1);
+    stat.ppid = std::atoi(s);
+    s = ToNextWord(s, 10);
+    if (!*s) {
+        std::cerr << "bad line in /proc/" << stat.pid << "/stat"
+                  << ": missing utime column #13" << std::endl;
+        return;
+    }
+    stat.utime = std::strtoull(s, nullptr, 10);
+    s = ToNextWord(s, 1);
+    stat.stime = std::strtoull(s, nullptr, 10);
+    s = ToNextWord(s, 7);
+    if (!*s) {
+        std::cerr << "bad line in /proc/" << stat.pid << "/stat"
+                  << ": missing starttime column #21" << std::endl;
+        return;
+    }
+    stat.starttime = std::strtoull(s, nullptr, 10);
+    s = ToNextWord(s, 17);
+    if (!*s) {
+        std::cerr << "bad line in /proc/" << stat.pid << "/stat"
+                  << ": missing CPU column #39" << std::endl;
+        return;
+    }
+    stat.cpu = std::atoi(s);
+}
+
+}
+
+void SetProcBackends(ProcListBackend list_backend, ProcReadBackend read_backend) {
+    proc_list_backend = list_backend;
+    proc_read_backend = read_backend;
+}
+
 void ReadProcPidStat(int pid, PidStat& stat) {
+    auto const& root = ProcRoot::Instance();
+    if (proc_read_backend == ProcReadBackend::syscall) {
+        // Whole file in a single read() into a stack buffer, without
+        // a stream and a heap-allocated line
+        char buf[1024];
+        char file_name[32];
+        *fmt::format_to_n(file_name, sizeof(file_name) - 1, "{}/stat", pid).out = '\0';
+        int fd = ::openat(root.proc_fd(), file_name, O_RDONLY | O_CLOEXEC);
+        ssize_t size = fd >= 0 ? ::read(fd, buf, sizeof(buf) - 1) : -1;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        if (size <= 0) {
+            stat.state = PidStat::State::not_found;
+            return;
+        }
+        buf[size] = '\0';
+        ParseProcPidStat(buf, stat);
+        return;
+    }
+    // Stream backend opens the file by the full path, as before roots were introduced
     std::ifstream ifs{};
-    auto file_name{fmt::format("/proc/{}/stat", pid)};
-    ifs.open(file_name, std::ios::in);
+    ifs.open(fmt::format("{}/{}/stat", root.proc_path(), pid), std::ios::in);
     if (ifs.fail()) {
         stat.state = PidStat::State::not_found;
     } else if (std::string line; std::getline(ifs, line)) {
-        const char *s = line.c_str();
-        s = ToNextWord(s, 2);
-        if (!*s) {
-            std::cerr << "bad line in " << file_name
-                      << ": missing state column #2" << std::endl;
-            stat.state = PidStat::State::not_found;
-            return;
-        }
-        stat.state = PidStateFromChar(*s);
-        s = ToNextWord(s, 36);
-        if (!*s) {
-            std::cerr << "bad line in " << file_name
-                      << ": missing CPU column #39" << std::endl;
-            return;
-        }
-        stat.cpu = std::atoi(s);
+        ParseProcPidStat(line.c_str(), stat);
+    }
+}
+
+const char *ToString(CpuMigration migration) {
+    switch (migration) {
+        case CpuMigration::none: return "none";
+        case CpuMigration::smt: return "smt";
+        case CpuMigration::same_socket: return "socket";
+        case CpuMigration::cross_socket: return "cross_socket";
+        default: return "unknown";
+    }
+}
+
+const char *ToString(AffinityViolation violation) {
+    switch (violation) {
+        case AffinityViolation::none: return "";
+        case AffinityViolation::outside_affinity: return "outside_affinity";
+        case AffinityViolation::foreign: return "foreign";
+        default: return "unknown";
     }
 }
 
@@ -122,6 +218,7 @@ PidStat::State PidStateFromChar(char c) {
         case 'X': case 'x': return PidStat::State::dead;
         case 'K': return PidStat::State::wakekill;
         case 'P': return PidStat::State::parked;
+        case 'I': return PidStat::State::idle;
         default: return PidStat::State::unknown;
     }
 }
@@ -139,13 +236,61 @@ const char *ToString(PidStat::State state) {
         case PidStat::State::wakekill: return "wakekill";
         case PidStat::State::waking_paging: return "waking or paging";
         case PidStat::State::parked: return "parked";
+        case PidStat::State::idle: return "idle";
         default: return "unknown";
     }
 }
 
+namespace {
+
+/** List PIDs with raw getdents64(), without stat() of every entry */
+std::vector<int> ListPidsGetdents() {
+    struct Dirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    std::vector<int> pids{};
+    // Own descriptor, since the directory offset is advanced by reading
+    int fd = ProcRoot::Instance().OpenProc(".", O_DIRECTORY);
+    if (fd < 0) {
+        return pids;
+    }
+    alignas(Dirent64) char buf[32 * 1024];
+    while (true) {
+        auto size = ::syscall(SYS_getdents64, fd, buf, sizeof(buf));
+        if (size <= 0) {
+            break;
+        }
+        for (long offset{}; offset < size;) {
+            auto const *entry = reinterpret_cast<Dirent64 const*>(buf + offset);
+            offset += entry->d_reclen;
+            // PID directories have names of digits only, d_type is not filled by every filesystem
+            if ((entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) || !std::isdigit(entry->d_name[0])) {
+                continue;
+            }
+            char *end{};
+            long pid = std::strtol(entry->d_name, &end, 10);
+            if (*end == '\0') {
+                pids.push_back(static_cast<int>(pid));
+            }
+        }
+    }
+    ::close(fd);
+    return pids;
+}
+
+}
+
 std::vector<int> ListPids() {
+    if (proc_list_backend == ProcListBackend::getdents) {
+        return ListPidsGetdents();
+    }
     std::vector<int> pids{};
-    for (auto const& entry: fs::directory_iterator("/proc")) {
+    for (auto const& entry: fs::directory_iterator(ProcRoot::Instance().proc_path())) {
         auto path = entry.path();
         // Check that this is a PID:
         // 1) it is a directory,
@@ -172,3 +317,87 @@ std::vector<int> ListPids() {
     }
     return pids;
 }
+
+bool ParsePressure(const char *s, PressureTotals& totals) {
+    /*
+     * PSI file format:
+     * some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+     * full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+     */
+    bool has_some{false};
+    totals.full_us = std::nullopt;
+    while (*s) {
+        bool is_some = std::strncmp(s, "some", 4) == 0;
+        bool is_full = std::strncmp(s, "full", 4) == 0;
+        const char *eol = std::strchr(s, '\n');
+        if (!eol) {
+            eol = s + std::strlen(s);
+        }
+        if (is_some || is_full) {
+            const char *total = std::strstr(s, "total=");
+            if (total && total < eol) {
+                auto value = std::strtoull(total + 6, nullptr, 10);
+                if (is_some) {
+                    totals.some_us = value;
+                    has_some = true;
+                } else {
+                    totals.full_us = value;
+                }
+            }
+        }
+        s = *eol ? eol + 1 : eol;
+    }
+    return has_some;
+}
+
+std::optional<std::string> ReadProcPidComm(int pid) {
+    auto content = ProcRoot::Instance().ReadProc(fmt::format("{}/comm", pid));
+    if (!content) {
+        return std::nullopt;
+    }
+    std::istringstream ifs{*content};
+    std::string comm{};
+    if (!std::getline(ifs, comm)) {
+        return std::nullopt;
+    }
+    return comm;
+}
+
+std::optional<unsigned> ReadProcPidUid(int pid) {
+    struct stat st{};
+    if (::fstatat(ProcRoot::Instance().proc_fd(), std::to_string(pid).c_str(), &st, 0) != 0) {
+        return std::nullopt;
+    }
+    return st.st_uid;
+}
+
+std::optional<std::string> ReadProcPidWchan(int pid) {
+    std::istringstream ifs{ProcRoot::Instance().ReadProc(fmt::format("{}/wchan", pid)).value_or("")};
+    std::string wchan{};
+    if (!std::getline(ifs, wchan) || wchan.empty() || wchan == "0") {
+        return std::nullopt;
+    }
+    return wchan;
+}
+
+std::optional<std::vector<std::string>> ReadProcPidKernelStack(int pid) {
+    /*
+     * Stack line format: "[<0>] do_select+0x6b4/0x7a0"
+     */
+    auto content = ProcRoot::Instance().ReadProc(fmt::format("{}/stack", pid));
+    if (!content) {
+        return std::nullopt;
+    }
+    std::istringstream ifs{*content};
+    std::vector<std::string> frames{};
+    std::string line{};
+    while (std::getline(ifs, line)) {
+        auto name_pos = line.find("] ");
+        auto name = line.substr(name_pos == std::string::npos ? 0 : name_pos + 2);
+        frames.push_back(name.substr(0, name.find('+')));
+    }
+    if (frames.empty()) {
+        return std::nullopt;
+    }
+    return frames;
+}
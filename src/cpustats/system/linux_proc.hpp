@@ -2,6 +2,8 @@
 #define CPUSTATS_LINUX_PROC_HPP
 
 #include <array>
+#include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -30,6 +32,45 @@ struct CpuInfo {
 };
 
 
+/** Per-thread perf counters deltas during the last interval */
+struct PidPerfStat {
+    uint64_t task_clock_ns{};
+    uint64_t context_switches{};
+    uint64_t migrations{};
+    std::optional<uint64_t> cycles{};
+    std::optional<uint64_t> instructions{};
+};
+
+
+/** Kind of CPU change of a thread between two observations */
+enum class CpuMigration {
+    none,
+    smt,           // to a sibling hardware thread of the same core
+    same_socket,   // to another core of the same package
+    cross_socket,  // to another package, or topology is unknown
+};
+
+const char *ToString(CpuMigration migration);
+
+/** Migrations of a thread, see PidManager::set_placement_tracking() */
+struct PidMigrationStat {
+    CpuMigration last{CpuMigration::none};  // since the previous observation
+    uint64_t smt{};                         // counts since the thread was first seen
+    uint64_t same_socket{};
+    uint64_t cross_socket{};
+};
+
+
+/** Result of checking the CPU of a thread, see PidManager::set_affinity_check() */
+enum class AffinityViolation {
+    none,
+    outside_affinity,  // on a CPU outside the affinity the thread had when first seen
+    foreign,           // not one of the threads given explicitly, on a reserved CPU
+};
+
+const char *ToString(AffinityViolation violation);
+
+
 struct PidStat {
     enum class State {
         running,
@@ -42,19 +83,56 @@ struct PidStat {
         wakekill,
         waking_paging,
         parked,
+        idle,
         not_found,
         unknown
     };
 
+    static constexpr size_t kCommSize = 16;  // TASK_COMM_LEN
+
     int pid{};
     State state{State::unknown};
+    std::array<char, kCommSize> comm{};  // NUL-terminated, may be truncated
+    int ppid{};
     int cpu{};
+    unsigned long long utime{};      // in clock ticks
+    unsigned long long stime{};      // in clock ticks
+    unsigned long long starttime{};  // in clock ticks after boot
+    std::optional<PidPerfStat> perf{};
+    std::optional<PidMigrationStat> migrations{};
+    AffinityViolation affinity_violation{AffinityViolation::none};
+};
+
+
+/** Cumulative stall times from a PSI file, `/proc/pressure/<resource>` */
+struct PressureTotals {
+    uint64_t some_us{};
+    std::optional<uint64_t> full_us{};
 };
 
 
 int GetCpuCount();
 std::vector<CpuInfo> LoadProcCpuInfo();
+/**
+ * Read `/proc/stat` lines of the CPUs listed in `cpus`, which must be
+ * sorted by `CpuStat::cpu`. Lines of other CPUs are skipped.
+ */
 void ReadProcStat(std::vector<CpuStat>& cpus);
+/** How PIDs are listed, see backend_probe.hpp */
+enum class ProcListBackend {
+    filesystem,  // std::filesystem::directory_iterator and a stat() per entry
+    getdents,    // raw getdents64() on /proc
+};
+
+/** How per-task files are read */
+enum class ProcReadBackend {
+    stream,   // std::ifstream
+    syscall,  // open(), a single read() into a stack buffer, close()
+};
+
+/** Select the backends used by ListPids() and ReadProcPidStat() */
+void SetProcBackends(ProcListBackend list_backend, ProcReadBackend read_backend);
+
 void ReadProcPidStat(int pid, PidStat& stat);
 
 PidStat::State PidStateFromChar(char c);
@@ -62,4 +140,34 @@ const char *ToString(PidStat::State state);
 
 std::vector<int> ListPids();
 
+/**
+ * Read command name of the task from `/proc/<pid>/comm`.
+ * Returns nullopt if the task does not exist.
+ */
+std::optional<std::string> ReadProcPidComm(int pid);
+
+/**
+ * Read effective user ID of the task, the owner of `/proc/<pid>`.
+ * Returns nullopt if the task does not exist.
+ */
+std::optional<unsigned> ReadProcPidUid(int pid);
+
+/**
+ * Read kernel function the task is blocked in from `/proc/<pid>/wchan`.
+ * Returns nullopt if the task does not exist or is not blocked.
+ */
+std::optional<std::string> ReadProcPidWchan(int pid);
+
+/**
+ * Read kernel stack of the task from `/proc/<pid>/stack` (needs
+ * CAP_SYS_ADMIN), one function name per frame, innermost first.
+ */
+std::optional<std::vector<std::string>> ReadProcPidKernelStack(int pid);
+
+/**
+ * Parse `total=` fields of `some` and `full` lines of PSI file content.
+ * @return false if the `some` line is missing
+ */
+bool ParsePressure(const char *s, PressureTotals& totals);
+
 #endif //CPUSTATS_LINUX_PROC_HPP
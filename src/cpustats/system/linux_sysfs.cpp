@@ -0,0 +1,98 @@
+#include "linux_sysfs.hpp"
+#include "proc_root.hpp"
+
+#include <fmt/format.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+std::vector<int> ParseCpuList(const char *s) {
+    std::vector<int> cpus{};
+    while (*s) {
+        if (!std::isdigit(*s)) {
+            s++;
+            continue;
+        }
+        char *end{};
+        int first = static_cast<int>(std::strtol(s, &end, 10));
+        int last = first;
+        if (*end == '-') {
+            last = static_cast<int>(std::strtol(end + 1, &end, 10));
+        }
+        for (int cpu{first}; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+        s = end;
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::string CpuIdleStatePath(int cpu, int state) {
+    return fmt::format("devices/system/cpu/cpu{}/cpuidle/state{}", cpu, state);
+}
+
+std::vector<CpuIdleStateInfo> LoadCpuIdleStates(int cpu) {
+    std::vector<CpuIdleStateInfo> states{};
+    // States are numbered contiguously starting from 0
+    for (int state{};; state++) {
+        auto dir = CpuIdleStatePath(cpu, state);
+        struct stat st{};
+        if (::fstatat(ProcRoot::Instance().sys_fd(), dir.c_str(), &st, 0) != 0 || !S_ISDIR(st.st_mode)) {
+            break;
+        }
+        CpuIdleStateInfo info{.cpu = cpu, .state = state};
+        std::istringstream name_ifs{ProcRoot::Instance().ReadSys(dir + "/name").value_or("")};
+        if (!std::getline(name_ifs, info.name) || info.name.empty()) {
+            info.name = fmt::format("state{}", state);
+        }
+        std::istringstream latency_ifs{ProcRoot::Instance().ReadSys(dir + "/latency").value_or("")};
+        latency_ifs >> info.latency_us;
+        states.push_back(std::move(info));
+    }
+    return states;
+}
+
+std::vector<CpuTopology> LoadCpuTopology() {
+    std::vector<CpuTopology> result{};
+    std::istringstream present_ifs{ProcRoot::Instance().ReadSys("devices/system/cpu/present").value_or("")};
+    std::string present{};
+    std::getline(present_ifs, present);
+    for (int cpu: ParseCpuList(present.c_str())) {
+        if (cpu >= result.size()) {
+            result.resize(cpu + 1);
+        }
+        auto& topology = result[cpu];
+        topology.cpu = cpu;
+        auto dir = fmt::format("devices/system/cpu/cpu{}/topology", cpu);
+        std::istringstream core_ifs{ProcRoot::Instance().ReadSys(dir + "/core_id").value_or("")};
+        core_ifs >> topology.core_id;
+        std::istringstream package_ifs{ProcRoot::Instance().ReadSys(dir + "/physical_package_id").value_or("")};
+        package_ifs >> topology.package_id;
+    }
+    return result;
+}
+
+std::vector<int> LoadIsolatedCpus() {
+    std::vector<int> cpus{};
+    for (auto path: {"devices/system/cpu/isolated", "devices/system/cpu/nohz_full"}) {
+        std::istringstream ifs{ProcRoot::Instance().ReadSys(path).value_or("")};
+        std::string list{};
+        // nohz_full contains "(null)" when the feature is off
+        if (std::getline(ifs, list) && !list.empty() && std::isdigit(list[0])) {
+            auto list_cpus = ParseCpuList(list.c_str());
+            cpus.insert(cpus.end(), list_cpus.begin(), list_cpus.end());
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
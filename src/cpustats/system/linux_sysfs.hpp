@@ -0,0 +1,54 @@
+#ifndef CPUSTATS_LINUX_SYSFS_HPP
+#define CPUSTATS_LINUX_SYSFS_HPP
+
+#include <string>
+#include <vector>
+
+
+struct CpuIdleStateInfo {
+    int cpu{};
+    int state{};
+    std::string name{};
+    int latency_us{};
+};
+
+
+/** Location of a CPU, from `/sys/devices/system/cpu/cpuN/topology` */
+struct CpuTopology {
+    int cpu{-1};  // -1 if the CPU is not present
+    int core_id{-1};
+    int package_id{-1};
+};
+
+
+/**
+ * Parse CPU list in kernel format, e.g. "0-3,8,10-11".
+ * Returns sorted CPU indices, or an empty vector if the list is empty.
+ */
+std::vector<int> ParseCpuList(const char *s);
+
+
+/** Path of the idle state directory, relative to the sys root (see ProcRoot) */
+std::string CpuIdleStatePath(int cpu, int state);
+
+/**
+ * List idle states of the given CPU from
+ * `/sys/devices/system/cpu/cpuN/cpuidle/stateK`.
+ * Returns an empty vector if cpuidle is not available.
+ */
+std::vector<CpuIdleStateInfo> LoadCpuIdleStates(int cpu);
+
+/**
+ * Load topology of all CPUs, indexed by CPU. Fields of CPUs without
+ * topology information (offline CPUs, some VMs) are left -1.
+ */
+std::vector<CpuTopology> LoadCpuTopology();
+
+/**
+ * List CPUs isolated from the scheduler (`isolcpus`) or running
+ * tickless (`nohz_full`), from `/sys/devices/system/cpu/isolated`
+ * and `/sys/devices/system/cpu/nohz_full`.
+ */
+std::vector<int> LoadIsolatedCpus();
+
+#endif //CPUSTATS_LINUX_SYSFS_HPP
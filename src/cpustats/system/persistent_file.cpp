@@ -0,0 +1,70 @@
+#include "persistent_file.hpp"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+
+PersistentFile::~PersistentFile() {
+    Close();
+}
+
+PersistentFile::PersistentFile(PersistentFile &&other) noexcept
+: fd_(other.fd_), dir_fd_(other.dir_fd_), path_(std::move(other.path_)) {
+    other.fd_ = -1;
+}
+
+PersistentFile& PersistentFile::operator=(PersistentFile &&other) noexcept {
+    if (this != &other) {
+        Close();
+        fd_ = other.fd_;
+        dir_fd_ = other.dir_fd_;
+        path_ = std::move(other.path_);
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+bool PersistentFile::Open(std::string const& path, int flags) {
+    return OpenAt(AT_FDCWD, path, flags);
+}
+
+bool PersistentFile::OpenAt(int dir_fd, std::string const& path, int flags) {
+    Close();
+    dir_fd_ = dir_fd;
+    path_ = path;
+    fd_ = ::openat(dir_fd, path.c_str(), O_RDONLY | O_CLOEXEC | flags);
+    return fd_ >= 0;
+}
+
+void PersistentFile::Close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+long PersistentFile::Read(char *buf, size_t size) const {
+    if (fd_ < 0 || size == 0) {
+        return -1;
+    }
+    auto n = ::pread(fd_, buf, size - 1, 0);
+    if (n < 0) {
+        buf[0] = '\0';
+        return -1;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+std::optional<uint64_t> PersistentFile::ReadUInt64() const {
+    char buf[32];
+    if (Read(buf, sizeof(buf)) <= 0) {
+        return std::nullopt;
+    }
+    char *end{};
+    auto value = std::strtoull(buf, &end, 10);
+    if (end == buf) {
+        return std::nullopt;
+    }
+    return value;
+}
@@ -0,0 +1,56 @@
+#ifndef CPUSTATS_PERSISTENT_FILE_HPP
+#define CPUSTATS_PERSISTENT_FILE_HPP
+
+#include <fcntl.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/**
+ * Read-only file descriptor that is kept open between reads.
+ *
+ * Procfs and sysfs files regenerate their content on every read from
+ * offset 0, so there is no need to reopen them on each tick: `Read()`
+ * uses `pread()` at offset 0 and avoids the path lookup and `open()`.
+ */
+class PersistentFile {
+public:
+    PersistentFile() = default;
+    explicit PersistentFile(std::string const& path) { Open(path); }
+    ~PersistentFile();
+
+    PersistentFile(PersistentFile const&) = delete;
+    PersistentFile& operator=(PersistentFile const&) = delete;
+    PersistentFile(PersistentFile&& other) noexcept;
+    PersistentFile& operator=(PersistentFile&& other) noexcept;
+
+    bool Open(std::string const& path, int flags = 0);
+    /** Open the file relative to the directory descriptor, see `openat()` */
+    bool OpenAt(int dir_fd, std::string const& path, int flags = 0);
+    void Close();
+
+    /**
+     * Read the whole file content into the buffer, starting from offset 0.
+     * The buffer is always NUL-terminated.
+     *
+     * @return number of bytes read, or -1 on error
+     */
+    long Read(char *buf, size_t size) const;
+
+    /** Read and parse the file as a single unsigned integer. */
+    [[nodiscard]] std::optional<uint64_t> ReadUInt64() const;
+
+    [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+    [[nodiscard]] int fd() const { return fd_; }
+    [[nodiscard]] std::string const& path() const { return path_; }
+    /** Directory the path is relative to, `AT_FDCWD` if opened by `Open()` */
+    [[nodiscard]] int dir_fd() const { return dir_fd_; }
+
+private:
+    int fd_{-1};
+    int dir_fd_{AT_FDCWD};
+    std::string path_{};
+};
+
+#endif //CPUSTATS_PERSISTENT_FILE_HPP
@@ -0,0 +1,81 @@
+#include "proc_root.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+
+ProcRoot& ProcRoot::Instance() {
+    static ProcRoot instance{};
+    // Default roots are opened once, readers running concurrently then see the same descriptors
+    static bool const opened = [] {
+        if (!instance.Open("/proc", "/sys")) {
+            std::cerr << "Error opening /proc or /sys\n";
+            return false;
+        }
+        return true;
+    }();
+    (void) opened;
+    return instance;
+}
+
+ProcRoot::~ProcRoot() {
+    if (proc_fd_ >= 0) ::close(proc_fd_);
+    if (sys_fd_ >= 0) ::close(sys_fd_);
+}
+
+bool ProcRoot::Open(std::string const& proc_path, std::string const& sys_path) {
+    int proc_fd = ::open(proc_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int sys_fd = ::open(sys_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0 || sys_fd < 0) {
+        if (proc_fd >= 0) ::close(proc_fd);
+        if (sys_fd >= 0) ::close(sys_fd);
+        return false;
+    }
+    if (proc_fd_ >= 0) ::close(proc_fd_);
+    if (sys_fd_ >= 0) ::close(sys_fd_);
+    proc_fd_ = proc_fd;
+    sys_fd_ = sys_fd;
+    proc_path_ = proc_path;
+    sys_path_ = sys_path;
+    return true;
+}
+
+int ProcRoot::OpenProc(std::string const& path, int flags) const {
+    return ::openat(proc_fd_, path.c_str(), O_RDONLY | O_CLOEXEC | flags);
+}
+
+int ProcRoot::OpenSys(std::string const& path, int flags) const {
+    return ::openat(sys_fd_, path.c_str(), O_RDONLY | O_CLOEXEC | flags);
+}
+
+std::optional<std::string> ProcRoot::ReadProc(std::string const& path) const {
+    return ReadFileAt(proc_fd_, path);
+}
+
+std::optional<std::string> ProcRoot::ReadSys(std::string const& path) const {
+    return ReadFileAt(sys_fd_, path);
+}
+
+std::optional<std::string> ReadFileAt(int dir_fd, std::string const& path) {
+    int fd = ::openat(dir_fd, path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    // Procfs and sysfs files report zero size, so read until EOF
+    std::string content{};
+    char buf[4096];
+    while (true) {
+        auto n = ::read(fd, buf, sizeof(buf));
+        if (n < 0) {
+            ::close(fd);
+            return std::nullopt;
+        }
+        if (n == 0) {
+            break;
+        }
+        content.append(buf, n);
+    }
+    ::close(fd);
+    return content;
+}
@@ -0,0 +1,58 @@
+#ifndef CPUSTATS_PROC_ROOT_HPP
+#define CPUSTATS_PROC_ROOT_HPP
+
+#include <optional>
+#include <string>
+
+/**
+ * Directories procfs and sysfs are read from, `/proc` and `/sys` by
+ * default. They may point to a host filesystem mounted in a sidecar
+ * container (e.g. `/host/proc`) or to a synthetic fixture tree.
+ *
+ * Both directories are kept open, and files are opened relative to
+ * them with `openat()`, so paths are always given without the root
+ * and without the leading slash, e.g. `"stat"` or `"123/stat"`.
+ */
+class ProcRoot {
+public:
+    /** Process-wide roots used by all system readers */
+    static ProcRoot& Instance();
+
+    ProcRoot() = default;
+    ~ProcRoot();
+
+    ProcRoot(ProcRoot const&) = delete;
+    ProcRoot& operator=(ProcRoot const&) = delete;
+
+    /** Open root directories, on error keeps the previous ones */
+    bool Open(std::string const& proc_path, std::string const& sys_path);
+
+    [[nodiscard]] int proc_fd() const { return proc_fd_; }
+    [[nodiscard]] int sys_fd() const { return sys_fd_; }
+    [[nodiscard]] std::string const& proc_path() const { return proc_path_; }
+    [[nodiscard]] std::string const& sys_path() const { return sys_path_; }
+
+    /** Open a file under the proc root, returns -1 on error */
+    [[nodiscard]] int OpenProc(std::string const& path, int flags = 0) const;
+    /** Open a file under the sys root, returns -1 on error */
+    [[nodiscard]] int OpenSys(std::string const& path, int flags = 0) const;
+
+    /** Read the whole file under the proc root, nullopt on error */
+    [[nodiscard]] std::optional<std::string> ReadProc(std::string const& path) const;
+    /** Read the whole file under the sys root, nullopt on error */
+    [[nodiscard]] std::optional<std::string> ReadSys(std::string const& path) const;
+
+private:
+    int proc_fd_{-1};
+    int sys_fd_{-1};
+    std::string proc_path_{};
+    std::string sys_path_{};
+};
+
+/**
+ * Read the whole file relative to the directory descriptor.
+ * Returns nullopt if the file can not be opened or read.
+ */
+std::optional<std::string> ReadFileAt(int dir_fd, std::string const& path);
+
+#endif //CPUSTATS_PROC_ROOT_HPP
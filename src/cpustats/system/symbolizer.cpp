@@ -0,0 +1,218 @@
+#include "symbolizer.hpp"
+#include "proc_root.hpp"
+
+#include <fmt/format.h>
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+// Kernel addresses occupy the upper half of the address space
+constexpr uint64_t kKernelAddressStart = 0xffff800000000000ULL;
+
+}
+
+
+bool Symbolizer::LoadMaps(int pid) {
+    /*
+     * maps line format:
+     * 7f2c4a000000-7f2c4a022000 r-xp 00000000 08:01 1234  /usr/lib/libc.so.6
+     */
+    auto content = ProcRoot::Instance().ReadProc(fmt::format("{}/maps", pid));
+    if (!content) {
+        return false;
+    }
+    std::istringstream ifs{*content};
+    std::vector<Mapping> mappings{};
+    std::string line{};
+    while (std::getline(ifs, line)) {
+        Mapping mapping{};
+        char perms[8]{};
+        int path_pos{-1};
+        if (std::sscanf(line.c_str(), "%lx-%lx %7s %lx %*s %*s %n",
+                        &mapping.start, &mapping.end, perms, &mapping.offset, &path_pos) < 4) {
+            continue;
+        }
+        if (perms[2] != 'x' || path_pos < 0 || path_pos >= line.size() || line[path_pos] != '/') {
+            continue;
+        }
+        mapping.path = line.substr(path_pos);
+        mappings.push_back(std::move(mapping));
+    }
+    maps_[pid] = std::move(mappings);
+    return true;
+}
+
+std::string Symbolizer::Symbolize(int pid, uint64_t ip) {
+    if (ip >= kKernelAddressStart) {
+        return SymbolizeKernel(ip);
+    }
+    auto maps_it = maps_.find(pid);
+    if (maps_it == maps_.end()) {
+        return fmt::format("[unknown+{:#x}]", ip);
+    }
+    for (auto const& mapping: maps_it->second) {
+        if (ip < mapping.start || ip >= mapping.end) {
+            continue;
+        }
+        auto file_offset = ip - mapping.start + mapping.offset;
+        auto const& file = GetElfFile(mapping.path);
+        for (auto const& segment: file.segments) {
+            if (file_offset < segment.offset || file_offset >= segment.offset + segment.size) {
+                continue;
+            }
+            auto vaddr = file_offset - segment.offset + segment.vaddr;
+            if (auto symbol = FindSymbol(file.symbols, vaddr)) {
+                return Demangle(symbol->name);
+            }
+            break;
+        }
+        auto name_pos = mapping.path.rfind('/');
+        return fmt::format("[{}+{:#x}]", mapping.path.substr(name_pos + 1), file_offset);
+    }
+    return fmt::format("[unknown+{:#x}]", ip);
+}
+
+Symbolizer::ElfFile const& Symbolizer::GetElfFile(std::string const& path) {
+    auto& file = elf_files_[path];
+    if (!file.loaded) {
+        LoadElfFile(path, file);
+        file.loaded = true;
+    }
+    return file;
+}
+
+std::string Symbolizer::SymbolizeKernel(uint64_t ip) {
+    if (!kernel_symbols_loaded_) {
+        /*
+         * kallsyms line format: "ffffffff81000000 T _stext"
+         * Addresses are zero unless the reader is privileged.
+         */
+        std::istringstream ifs{ProcRoot::Instance().ReadProc("kallsyms").value_or("")};
+        std::string line{};
+        while (std::getline(ifs, line)) {
+            std::istringstream ss{line};
+            Symbol symbol{};
+            std::string type{};
+            if (!(ss >> std::hex >> symbol.addr >> type >> symbol.name) || symbol.addr == 0) {
+                continue;
+            }
+            if (type == "t" || type == "T" || type == "w" || type == "W") {
+                kernel_symbols_.push_back(std::move(symbol));
+            }
+        }
+        std::sort(kernel_symbols_.begin(), kernel_symbols_.end(),
+                  [](auto const& a, auto const& b) { return a.addr < b.addr; });
+        kernel_symbols_loaded_ = true;
+    }
+    // Kernel symbols have no sizes, the closest preceding one is taken
+    auto it = std::upper_bound(kernel_symbols_.begin(), kernel_symbols_.end(), ip,
+                               [](uint64_t addr, auto const& symbol) { return addr < symbol.addr; });
+    if (it == kernel_symbols_.begin()) {
+        return "[kernel]";
+    }
+    return std::prev(it)->name + "_[k]";
+}
+
+void Symbolizer::LoadElfFile(std::string const& path, ElfFile& file) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Elf64_Ehdr))) {
+        close(fd);
+        return;
+    }
+    auto size = static_cast<size_t>(st.st_size);
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    auto const *bytes = static_cast<const char *>(data);
+    auto const *ehdr = static_cast<const Elf64_Ehdr *>(data);
+    auto in_file = [size](uint64_t offset, uint64_t length) {
+        return offset <= size && length <= size - offset;
+    };
+    if (std::memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != ELFCLASS64 ||
+        !in_file(ehdr->e_phoff, ehdr->e_phnum * sizeof(Elf64_Phdr)) ||
+        !in_file(ehdr->e_shoff, ehdr->e_shnum * sizeof(Elf64_Shdr))) {
+        munmap(data, size);
+        return;
+    }
+
+    auto const *phdrs = reinterpret_cast<const Elf64_Phdr *>(bytes + ehdr->e_phoff);
+    for (int i{}; i < ehdr->e_phnum; i++) {
+        if (phdrs[i].p_type == PT_LOAD) {
+            file.segments.push_back({phdrs[i].p_offset, phdrs[i].p_vaddr, phdrs[i].p_filesz});
+        }
+    }
+
+    // Prefer the full symbol table, stripped binaries have only the dynamic one
+    auto const *shdrs = reinterpret_cast<const Elf64_Shdr *>(bytes + ehdr->e_shoff);
+    for (auto type: {SHT_SYMTAB, SHT_DYNSYM}) {
+        for (int i{}; i < ehdr->e_shnum && file.symbols.empty(); i++) {
+            auto const& shdr = shdrs[i];
+            if (shdr.sh_type != type || shdr.sh_link >= ehdr->e_shnum) {
+                continue;
+            }
+            auto const& strtab = shdrs[shdr.sh_link];
+            if (!in_file(shdr.sh_offset, shdr.sh_size) || !in_file(strtab.sh_offset, strtab.sh_size)) {
+                continue;
+            }
+            auto const *syms = reinterpret_cast<const Elf64_Sym *>(bytes + shdr.sh_offset);
+            size_t n_syms = shdr.sh_size / sizeof(Elf64_Sym);
+            for (size_t k{}; k < n_syms; k++) {
+                auto const& sym = syms[k];
+                if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_value == 0 ||
+                    sym.st_name >= strtab.sh_size) {
+                    continue;
+                }
+                auto const *name = bytes + strtab.sh_offset + sym.st_name;
+                auto name_len = strnlen(name, strtab.sh_size - sym.st_name);
+                file.symbols.push_back({sym.st_value, sym.st_size, std::string{name, name_len}});
+            }
+        }
+        if (!file.symbols.empty()) {
+            break;
+        }
+    }
+    std::sort(file.symbols.begin(), file.symbols.end(),
+              [](auto const& a, auto const& b) { return a.addr < b.addr; });
+    munmap(data, size);
+}
+
+Symbolizer::Symbol const *Symbolizer::FindSymbol(std::vector<Symbol> const& symbols, uint64_t addr) {
+    auto it = std::upper_bound(symbols.begin(), symbols.end(), addr,
+                               [](uint64_t value, auto const& symbol) { return value < symbol.addr; });
+    if (it == symbols.begin()) {
+        return nullptr;
+    }
+    auto const& symbol = *std::prev(it);
+    if (symbol.size > 0 && addr >= symbol.addr + symbol.size) {
+        return nullptr;
+    }
+    return &symbol;
+}
+
+std::string Symbolizer::Demangle(std::string const& name) {
+    int status{};
+    char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (status != 0 || !demangled) {
+        return name;
+    }
+    std::string result{demangled};
+    std::free(demangled);
+    return result;
+}
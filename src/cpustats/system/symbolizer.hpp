@@ -0,0 +1,63 @@
+#ifndef CPUSTATS_SYMBOLIZER_HPP
+#define CPUSTATS_SYMBOLIZER_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+ * Resolves instruction pointers of user-space tasks to function names
+ * using `/proc/<pid>/maps` and ELF symbol tables (.symtab or .dynsym),
+ * and kernel addresses using `/proc/kallsyms`.
+ *
+ * ELF files are parsed lazily, once per file.
+ */
+class Symbolizer {
+public:
+    /** Read memory mappings of the task. Later calls replace earlier ones. */
+    bool LoadMaps(int pid);
+
+    std::string Symbolize(int pid, uint64_t ip);
+
+private:
+    struct Mapping {
+        uint64_t start{};
+        uint64_t end{};
+        uint64_t offset{};
+        std::string path{};
+    };
+
+    struct Symbol {
+        uint64_t addr{};
+        uint64_t size{};
+        std::string name{};
+    };
+
+    struct Segment {
+        uint64_t offset{};
+        uint64_t vaddr{};
+        uint64_t size{};
+    };
+
+    struct ElfFile {
+        bool loaded{false};
+        std::vector<Segment> segments{};
+        std::vector<Symbol> symbols{};  // sorted by address
+    };
+
+    std::unordered_map<int, std::vector<Mapping>> maps_{};
+    std::unordered_map<std::string, ElfFile> elf_files_{};
+    std::vector<Symbol> kernel_symbols_{};
+    bool kernel_symbols_loaded_{false};
+
+    ElfFile const& GetElfFile(std::string const& path);
+    std::string SymbolizeKernel(uint64_t ip);
+
+    static void LoadElfFile(std::string const& path, ElfFile& file);
+    static Symbol const *FindSymbol(std::vector<Symbol> const& symbols, uint64_t addr);
+    static std::string Demangle(std::string const& name);
+};
+
+#endif //CPUSTATS_SYMBOLIZER_HPP
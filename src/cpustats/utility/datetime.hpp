@@ -2,13 +2,56 @@
 #define CPUSTATS_DATETIME_HPP
 
 #include <date.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <ctime>
+#include <optional>
 #include <string>
 
+/**
+ * Time a snapshot was taken at, set while a consumer thread that lags
+ * behind the sampler handles it. Timestamps then show when values were
+ * sampled rather than when they are written.
+ */
+inline thread_local std::optional<std::chrono::system_clock::time_point> snapshot_time{};
+
+/** Monotonic time the snapshot was taken at, set along with snapshot_time */
+inline thread_local std::optional<std::chrono::steady_clock::time_point> snapshot_steady_time{};
+
 template <class Precision>
 std::string GetISOCurrentTime()
 {
-    auto now = std::chrono::system_clock::now();
+    auto now = snapshot_time.value_or(std::chrono::system_clock::now());
     return date::format("%T", date::floor<Precision>(now));
 }
 
+/**
+ * Monotonic time of the current iteration, to measure intervals between
+ * iterations: a consumer catching up on several snapshots in a row would
+ * otherwise see them milliseconds apart.
+ */
+inline std::chrono::steady_clock::time_point GetSteadyCurrentTime()
+{
+    return snapshot_steady_time.value_or(std::chrono::steady_clock::now());
+}
+
+/**
+ * Time since boot of the current iteration in clock ticks, the unit of
+ * task start times in `/proc/<pid>/stat`
+ */
+inline unsigned long long GetClockTicksSinceBoot()
+{
+    static auto const ticks_per_second = static_cast<long long>(sysconf(_SC_CLK_TCK));
+    timespec ts{};
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    auto now = std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+    if (snapshot_steady_time) {
+        now -= std::chrono::steady_clock::now() - *snapshot_steady_time;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    return static_cast<unsigned long long>(ns / 1'000'000'000 * ticks_per_second +
+                                           ns % 1'000'000'000 * ticks_per_second / 1'000'000'000);
+}
+
 #endif //CPUSTATS_DATETIME_HPP
@@ -0,0 +1,108 @@
+#ifndef CPUSTATS_FLAT_HASH_MAP_HPP
+#define CPUSTATS_FLAT_HASH_MAP_HPP
+
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * Open addressing hash map with linear probing, meant to be refilled
+ * on every iteration. Clear() is O(1): slots are stamped with a
+ * generation and slots of older generations are treated as free, so
+ * the storage is reused without reallocations once it has grown.
+ *
+ * Elements can not be erased one by one. Pointers to values are
+ * invalidated when the map grows.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class FlatHashMap {
+public:
+    explicit FlatHashMap(size_t capacity = 64) {
+        size_t n = 8;
+        while (n < capacity) n <<= 1;
+        slots_.resize(n);
+    }
+
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    void Clear() {
+        size_ = 0;
+        if (++generation_ == 0) {
+            // Generation counter wrapped, stamps of old slots must not match
+            for (auto& slot: slots_) slot.generation = 0;
+            generation_ = 1;
+        }
+    }
+
+    Value *Find(Key const& key) {
+        for (size_t i = Index(key);; i = (i + 1) & mask()) {
+            auto& slot = slots_[i];
+            if (slot.generation != generation_) return nullptr;
+            if (slot.key == key) return &slot.value;
+        }
+    }
+
+    /**
+     * Find the value by key or insert a value-initialized one.
+     * @return pointer to the value and true if it was inserted
+     */
+    std::pair<Value*, bool> TryEmplace(Key const& key) {
+        if (2 * (size_ + 1) > slots_.size()) {
+            Grow();
+        }
+        for (size_t i = Index(key);; i = (i + 1) & mask()) {
+            auto& slot = slots_[i];
+            if (slot.generation != generation_) {
+                slot.key = key;
+                slot.value = Value{};
+                slot.generation = generation_;
+                size_++;
+                return {&slot.value, true};
+            }
+            if (slot.key == key) return {&slot.value, false};
+        }
+    }
+
+    template<typename F>
+    void ForEach(F&& f) {
+        for (auto& slot: slots_) {
+            if (slot.generation == generation_) f(slot.key, slot.value);
+        }
+    }
+
+private:
+    struct Slot {
+        Key key{};
+        Value value{};
+        unsigned generation{};
+    };
+
+    std::vector<Slot> slots_{};
+    unsigned generation_{1};
+    size_t size_{};
+
+    [[nodiscard]] size_t mask() const { return slots_.size() - 1; }
+
+    [[nodiscard]] size_t Index(Key const& key) const {
+        // Fibonacci hashing spreads sequential keys (PIDs, UIDs) over the table
+        return (static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull) >> (64 - std::countr_zero(slots_.size()));
+    }
+
+    void Grow() {
+        std::vector<Slot> old(slots_.size() * 2);
+        old.swap(slots_);
+        auto old_generation = generation_;
+        generation_ = 1;
+        size_ = 0;
+        for (auto& slot: old) {
+            if (slot.generation == old_generation) {
+                *TryEmplace(slot.key).first = std::move(slot.value);
+            }
+        }
+    }
+};
+
+#endif //CPUSTATS_FLAT_HASH_MAP_HPP
@@ -0,0 +1,140 @@
+#ifndef CPUSTATS_SNAPSHOT_RING_HPP
+#define CPUSTATS_SNAPSHOT_RING_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/** What happens once a consumer falls a whole ring behind the producer */
+enum class SlowConsumerPolicy {
+    block,        // keep every snapshot, the producer waits for the consumer
+    drop_oldest,  // the producer takes over the oldest unread snapshot
+    coalesce,     // as drop_oldest, and the consumer skips to the latest snapshot
+};
+
+/**
+ * Ring of preallocated slots in the style of the LMAX Disruptor: a single
+ * producer publishes snapshots by sequence number, every consumer reads
+ * them at its own cursor. There are no locks, threads only wait on
+ * atomics when there is nothing to read or no slot to write.
+ *
+ * A slot is reused once every cursor has moved past it. The producer
+ * moves cursors of consumers that may lose snapshots on its own, unless
+ * the consumer holds the slot between Acquire() and Release(); such
+ * consumers should copy the snapshot out and release it right away.
+ */
+template<typename T>
+class SnapshotRing {
+public:
+    explicit SnapshotRing(size_t capacity = 64) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        slots_.resize(n);
+    }
+
+    SnapshotRing(SnapshotRing const&) = delete;
+    SnapshotRing& operator=(SnapshotRing const&) = delete;
+
+    /** Add a consumer before anything is published, returns its cursor */
+    size_t AddCursor(SlowConsumerPolicy policy) {
+        assert(published_.load() == 0);
+        auto& cursor = cursors_.emplace_back(std::make_unique<Cursor>());
+        cursor->policy = policy;
+        return cursors_.size() - 1;
+    }
+
+    [[nodiscard]] size_t capacity() const { return slots_.size(); }
+
+    // Producer side
+
+    /** Slot of the next snapshot, waits until no consumer needs it */
+    T& Claim() {
+        auto seq = published_.load(std::memory_order_relaxed) & ~kClosed;
+        for (auto const& cursor: cursors_) {
+            auto next = cursor->next.load(std::memory_order_acquire);
+            while (seq - (next & ~kHeld) >= slots_.size()) {
+                if (cursor->policy == SlowConsumerPolicy::block || (next & kHeld)) {
+                    cursor->next.wait(next, std::memory_order_acquire);
+                    next = cursor->next.load(std::memory_order_acquire);
+                } else {
+                    // Lose the oldest snapshot, the consumer counts the gap
+                    cursor->next.compare_exchange_weak(next, next + 1, std::memory_order_acq_rel);
+                }
+            }
+        }
+        return slots_[seq & (slots_.size() - 1)];
+    }
+
+    /** Make the claimed slot visible to consumers */
+    void Publish() {
+        published_.fetch_add(1, std::memory_order_release);
+        published_.notify_all();
+    }
+
+    /** No more snapshots, consumers stop once they have read the published ones */
+    void Close() {
+        published_.fetch_or(kClosed, std::memory_order_release);
+        published_.notify_all();
+    }
+
+    // Consumer side
+
+    /**
+     * Wait for the next snapshot of the cursor and hold its slot until
+     * Release().
+     * @return nullptr once the ring is closed and all snapshots were read
+     */
+    T const* Acquire(size_t index) {
+        auto& cursor = *cursors_[index];
+        auto next = cursor.next.load(std::memory_order_acquire);
+        while (true) {
+            auto published = published_.load(std::memory_order_acquire);
+            auto seq = published & ~kClosed;
+            if (next == seq) {
+                if (published & kClosed) {
+                    return nullptr;
+                }
+                published_.wait(published, std::memory_order_acquire);
+                next = cursor.next.load(std::memory_order_acquire);
+                continue;
+            }
+            auto target = cursor.policy == SlowConsumerPolicy::coalesce ? seq - 1 : next;
+            // Fails if the producer has just moved the cursor, next is reloaded then
+            if (cursor.next.compare_exchange_weak(next, target | kHeld, std::memory_order_acq_rel)) {
+                cursor.dropped += target - cursor.read;
+                cursor.read = target + 1;
+                return &slots_[target & (slots_.size() - 1)];
+            }
+        }
+    }
+
+    /** Done with the snapshot returned by Acquire(), its slot can be reused */
+    void Release(size_t index) {
+        auto& cursor = *cursors_[index];
+        cursor.next.store(cursor.read, std::memory_order_release);
+        cursor.next.notify_one();
+    }
+
+    /** Snapshots the cursor has lost, read by its consumer only */
+    [[nodiscard]] uint64_t dropped(size_t index) const { return cursors_[index]->dropped; }
+
+private:
+    static constexpr uint64_t kClosed = uint64_t{1} << 63;
+    static constexpr uint64_t kHeld = uint64_t{1} << 63;
+
+    struct Cursor {
+        alignas(64) std::atomic<uint64_t> next{};  // sequence of the next snapshot to read, and kHeld
+        SlowConsumerPolicy policy{SlowConsumerPolicy::block};
+        uint64_t read{};  // sequence after the last acquired snapshot
+        uint64_t dropped{};
+    };
+
+    std::vector<T> slots_{};
+    alignas(64) std::atomic<uint64_t> published_{};  // number of published snapshots, and kClosed
+    std::vector<std::unique_ptr<Cursor>> cursors_{};
+};
+
+#endif //CPUSTATS_SNAPSHOT_RING_HPP
@@ -0,0 +1,58 @@
+#ifndef CPUSTATS_TIMING_WHEEL_HPP
+#define CPUSTATS_TIMING_WHEEL_HPP
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Hashed timing wheel: values scheduled a number of ticks ahead are
+ * put into the slot the cursor reaches at that tick, with the number
+ * of full turns left. Advancing by one tick only visits a single slot,
+ * so the cost does not depend on how many values wait for later ticks.
+ */
+template<typename T>
+class TimingWheel {
+public:
+    explicit TimingWheel(size_t num_slots = 64) {
+        size_t n = 1;
+        while (n < num_slots) n <<= 1;
+        slots_.resize(n);
+    }
+
+    /** Schedule the value `delay` ticks ahead, delay >= 1 */
+    void Schedule(T value, uint64_t delay) {
+        auto mask = slots_.size() - 1;
+        slots_[(cursor_ + delay) & mask].push_back({std::move(value), (delay - 1) / slots_.size()});
+    }
+
+    /** Advance by one tick and append values that are due to `due` */
+    void Advance(std::vector<T>& due) {
+        cursor_ = (cursor_ + 1) & (slots_.size() - 1);
+        auto& slot = slots_[cursor_];
+        size_t kept{};
+        for (auto& entry: slot) {
+            if (entry.rounds == 0) {
+                due.push_back(std::move(entry.value));
+            } else {
+                entry.rounds--;
+                slot[kept++] = std::move(entry);
+            }
+        }
+        slot.resize(kept);
+    }
+
+    void Clear() {
+        for (auto& slot: slots_) slot.clear();
+    }
+
+private:
+    struct Entry {
+        T value;
+        uint64_t rounds;
+    };
+
+    std::vector<std::vector<Entry>> slots_{};
+    size_t cursor_{};
+};
+
+#endif //CPUSTATS_TIMING_WHEEL_HPP
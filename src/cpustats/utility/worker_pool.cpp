@@ -0,0 +1,52 @@
+#include "worker_pool.hpp"
+
+WorkerPool::WorkerPool(size_t num_threads) {
+    for (size_t i{}; i < num_threads; i++) {
+        threads_.emplace_back([this]() { Work(); });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    // jthreads are joined by their destructors
+}
+
+void WorkerPool::Run(std::span<std::function<void()> const> tasks) {
+    std::unique_lock lock{mutex_};
+    tasks_ = tasks;
+    next_task_ = 0;
+    pending_tasks_ = tasks.size();
+    work_cv_.notify_all();
+    while (RunNext(lock)) {}
+    done_cv_.wait(lock, [this]() { return pending_tasks_ == 0; });
+    tasks_ = {};
+}
+
+void WorkerPool::Work() {
+    std::unique_lock lock{mutex_};
+    while (true) {
+        work_cv_.wait(lock, [this]() { return stopping_ || next_task_ < tasks_.size(); });
+        if (stopping_) {
+            return;
+        }
+        while (RunNext(lock)) {}
+    }
+}
+
+bool WorkerPool::RunNext(std::unique_lock<std::mutex>& lock) {
+    if (next_task_ >= tasks_.size()) {
+        return false;
+    }
+    auto const& task = tasks_[next_task_++];
+    lock.unlock();
+    task();
+    lock.lock();
+    if (--pending_tasks_ == 0) {
+        done_cv_.notify_one();
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef CPUSTATS_WORKER_POOL_HPP
+#define CPUSTATS_WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of threads running batches of tasks. The calling thread
+ * takes part in every batch, so a pool without threads runs the tasks
+ * one after another.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t num_threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(WorkerPool const&) = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+
+    /** Run all tasks and return when every one of them has finished */
+    void Run(std::span<std::function<void()> const> tasks);
+
+    [[nodiscard]] size_t num_threads() const { return threads_.size(); }
+
+private:
+    std::mutex mutex_{};
+    std::condition_variable work_cv_{};
+    std::condition_variable done_cv_{};
+    std::span<std::function<void()> const> tasks_{};
+    size_t next_task_{};
+    size_t pending_tasks_{};
+    bool stopping_{false};
+    std::vector<std::jthread> threads_{};
+
+    void Work();
+    bool RunNext(std::unique_lock<std::mutex>& lock);
+};
+
+#endif //CPUSTATS_WORKER_POOL_HPP
@@ -1,24 +1,62 @@
+#include "cpustats/managers/cgroup_manager.hpp"
 #include "cpustats/managers/cpu_manager.hpp"
+#include "cpustats/managers/cpuidle_manager.hpp"
+#include "cpustats/managers/perf_cpu_manager.hpp"
 #include "cpustats/managers/pid_manager.hpp"
+#include "cpustats/managers/pressure_manager.hpp"
+#include "cpustats/managers/process_tree_manager.hpp"
+#include "cpustats/managers/profile_manager.hpp"
+#include "cpustats/managers/scheduler.hpp"
 #include "cpustats/consumers/table.hpp"
+#include "cpustats/consumers/consumer_pipeline.hpp"
+#include "cpustats/consumers/cpu_attribution.hpp"
 #include "cpustats/consumers/csv_output.hpp"
+#include "cpustats/consumers/d_state_watchdog.hpp"
+#include "cpustats/consumers/folded_stacks.hpp"
+#include "cpustats/consumers/isolation_watchdog.hpp"
+#include "cpustats/consumers/task_groups.hpp"
+#include "cpustats/system/backend_probe.hpp"
+#include "cpustats/system/control_socket.hpp"
+#include "cpustats/system/event_loop.hpp"
+#include "cpustats/system/interval_timer.hpp"
+#include "cpustats/system/proc_root.hpp"
+#include "cpustats/system/linux_cgroup.hpp"
+#include "cpustats/system/linux_sysfs.hpp"
 
 #include <cxxopts.hpp>
 #include <date.h>
 
+#include <sys/signalfd.h>
+#include <unistd.h>
+
 #include <chrono>
-#include <condition_variable>
+#include <cmath>
 #include <csignal>
 #include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
 #include <thread>
 #include <vector>
 
 using namespace std::chrono_literals;
 
-// ---- Global state -----
-std::mutex should_stop_m{};
-std::condition_variable should_stop_cv{};
-bool should_stop{};
+
+std::optional<SlowConsumerPolicy> ParseSlowConsumerPolicy(std::string const& name) {
+    if (name == "block") return SlowConsumerPolicy::block;
+    if (name == "drop-oldest") return SlowConsumerPolicy::drop_oldest;
+    if (name == "coalesce") return SlowConsumerPolicy::coalesce;
+    return std::nullopt;
+}
+
+const char *ToString(SlowConsumerPolicy policy) {
+    switch (policy) {
+        case SlowConsumerPolicy::block: return "block";
+        case SlowConsumerPolicy::drop_oldest: return "drop-oldest";
+        case SlowConsumerPolicy::coalesce: return "coalesce";
+    }
+    return "unknown";
+}
 
 
 struct Settings {
@@ -26,9 +64,55 @@ struct Settings {
     std::vector<int> pids{};
     std::string cpu_stats_file_name{};
     std::string pid_stats_file_name{};
-    int interval_ms{1'000};
+    std::string cpuidle_stats_file_name{};
+    std::string pressure_stats_file_name{};
+    std::vector<std::string> pressure_cgroups{};
+    std::string pressure_trigger{};
+    std::string cgroup_tree{};
+    std::string cgroup_stats_file_name{};
+    double interval_ms{1'000};
+    bool align_ticks{false};
+    std::map<std::string, double> periods_ms{};  // by source name
+    int sample_threads{3};
+    std::string tick_stats_file_name{};
+    bool inline_consumers{false};
+    int ring_size{64};
+    SlowConsumerPolicy slow_consumer_policy{SlowConsumerPolicy::block};
+    std::map<std::string, SlowConsumerPolicy> slow_consumer_policies{};  // by consumer name
     bool all_pids{false};
+    bool run_queue{false};
+    int top_pids{0};
+    std::string placement_file_name{};
+    bool affinity_check{false};
+    std::vector<int> reserved_cpus{};
+    std::string comm_pattern{};
+    std::string pids_cgroup{};
+    bool pids_perf{false};
+    bool profile{false};
+    std::string profile_file_name{};
+    int profile_frequency{99};
+    int d_state_threshold_ms{};
+    std::string d_state_file_name{};
+    std::vector<int> tree_pids{};
+    bool tree_children{false};
+    std::string tree_stats_file_name{};
+    std::string uid_stats_file_name{};
+    std::string comm_stats_file_name{};
+    int group_top{10};
+    bool isolation{false};
+    std::vector<int> isolated_cpus{};
+    std::vector<std::string> isolation_allowed_comms{};
+    std::string isolation_file_name{};
+    std::string attribution_file_name{};
+    int attribution_top{3};
+    std::string backend{"auto"};
+    std::string control_socket_path{};
+    std::string proc_root{"/proc"};
+    std::string sys_root{"/sys"};
     bool normalize_cpu_utility{false};
+    bool container{false};
+    std::string perf_cpu_stats_file_name{};
+    bool perf_hardware_events{false};
 
     [[nodiscard]] std::string String() const {
         std::stringstream ss;
@@ -39,9 +123,78 @@ struct Settings {
             ss << pids[i];
         }
         ss << "]\n";
+        ss << "top_pids: " << top_pids << std::endl;
+        ss << "run_queue: " << (run_queue ? "yes" : "no") << std::endl;
+        ss << "placement_file_name: " << placement_file_name << std::endl;
+        ss << "affinity_check: " << (affinity_check ? "yes" : "no") << std::endl;
+        ss << "reserved_cpus: [";
+        for (int i{}; i < reserved_cpus.size(); i++) {
+            if (i > 0) ss << ", ";
+            ss << reserved_cpus[i];
+        }
+        ss << "]\n";
+        ss << "comm_pattern: " << comm_pattern << std::endl;
+        ss << "pids_cgroup: " << pids_cgroup << std::endl;
+        ss << "pids_perf: " << (pids_perf ? "yes" : "no") << std::endl;
+        ss << "profile: " << (profile ? "yes" : "no") << std::endl;
+        ss << "profile_file_name: " << profile_file_name << std::endl;
+        ss << "profile_frequency: " << profile_frequency << std::endl;
+        ss << "d_state_threshold_ms: " << d_state_threshold_ms << std::endl;
+        ss << "d_state_file_name: " << d_state_file_name << std::endl;
+        ss << "tree_pids: [";
+        for (int i{}; i < tree_pids.size(); i++) {
+            if (i > 0) ss << ", ";
+            ss << tree_pids[i];
+        }
+        ss << "]\n";
+        ss << "tree_children: " << (tree_children ? "yes" : "no") << std::endl;
+        ss << "tree_stats_file_name: " << tree_stats_file_name << std::endl;
+        ss << "uid_stats_file_name: " << uid_stats_file_name << std::endl;
+        ss << "comm_stats_file_name: " << comm_stats_file_name << std::endl;
+        ss << "group_top: " << group_top << std::endl;
+        ss << "isolation: " << (isolation ? "yes" : "no") << std::endl;
+        ss << "isolated_cpus: [";
+        for (int i{}; i < isolated_cpus.size(); i++) {
+            if (i > 0) ss << ", ";
+            ss << isolated_cpus[i];
+        }
+        ss << "]\n";
+        ss << "isolation_allowed_comms: [";
+        for (int i{}; i < isolation_allowed_comms.size(); i++) {
+            if (i > 0) ss << ", ";
+            ss << isolation_allowed_comms[i];
+        }
+        ss << "]\n";
+        ss << "isolation_file_name: " << isolation_file_name << std::endl;
+        ss << "attribution_file_name: " << attribution_file_name << std::endl;
+        ss << "attribution_top: " << attribution_top << std::endl;
         ss << "cpu_stats_file_name: " << cpu_stats_file_name << std::endl;
         ss << "pid_stats_file_name: " << pid_stats_file_name << std::endl;
+        ss << "cpuidle_stats_file_name: " << cpuidle_stats_file_name << std::endl;
+        ss << "pressure_stats_file_name: " << pressure_stats_file_name << std::endl;
+        ss << "pressure_trigger: " << pressure_trigger << std::endl;
+        ss << "cgroup_tree: " << cgroup_tree << std::endl;
+        ss << "cgroup_stats_file_name: " << cgroup_stats_file_name << std::endl;
+        ss << "backend: " << backend << std::endl;
+        ss << "control_socket_path: " << control_socket_path << std::endl;
+        ss << "proc_root: " << proc_root << std::endl;
+        ss << "sys_root: " << sys_root << std::endl;
         ss << "interval_ms: " << interval_ms << std::endl;
+        ss << "align_ticks: " << (align_ticks ? "yes" : "no") << std::endl;
+        for (auto const& [source, period_ms]: periods_ms) {
+            ss << "period_ms: " << source << "=" << period_ms << std::endl;
+        }
+        ss << "sample_threads: " << sample_threads << std::endl;
+        ss << "tick_stats_file_name: " << tick_stats_file_name << std::endl;
+        ss << "inline_consumers: " << (inline_consumers ? "yes" : "no") << std::endl;
+        ss << "ring_size: " << ring_size << std::endl;
+        ss << "slow_consumer_policy: " << ToString(slow_consumer_policy) << std::endl;
+        for (auto const& [consumer, policy]: slow_consumer_policies) {
+            ss << "slow_consumer_policy: " << consumer << "=" << ToString(policy) << std::endl;
+        }
+        ss << "container: " << (container ? "yes" : "no") << std::endl;
+        ss << "perf_cpu_stats_file_name: " << perf_cpu_stats_file_name << std::endl;
+        ss << "perf_hardware_events: " << (perf_hardware_events ? "yes" : "no") << std::endl;
         return ss.str();
     }
 };
@@ -53,13 +206,94 @@ cxxopts::Options BuildOptions() {
             "Measure CPU utilization and track threads cores"
     );
     options.add_options()
-            ("i,interval", "Interval between measurements in milliseconds", cxxopts::value<int>()->default_value("1000"))
+            ("i,interval", "Interval between measurements in milliseconds, down to 0.1", cxxopts::value<double>()->default_value("1000"))
+            ("period", "Sampling period of a source, SOURCE=MS (e.g. pid=5000), rounded to whole intervals; "
+                       "sources: cpu, pid, cpuidle, pressure, cgroup, perf-cpu, profile, tree",
+                    cxxopts::value<std::vector<std::string>>())
+            ("sample-threads", "Threads sampling sources of a tick in parallel besides the main one, 0 samples them in turn",
+                    cxxopts::value<int>()->default_value("3"))
+            ("tick-file", "CSV file name to record sampling time of every tick and the skew between its sources",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("inline-consumers", "Run consumers on the sampling thread instead of a thread each",
+                    cxxopts::value<bool>()->default_value("false"))
+            ("ring-size", "Number of ticks buffered for consumers running on their own threads",
+                    cxxopts::value<int>()->default_value("64"))
+            ("slow-consumer", "What a consumer falling behind does, [NAME=]POLICY (e.g. table=coalesce); "
+                              "policies: block (sampling waits), drop-oldest, coalesce (only the latest tick)",
+                    cxxopts::value<std::vector<std::string>>())
+            ("align", "Align measurements to wall-clock multiples of the interval, e.g. to whole seconds",
+                    cxxopts::value<bool>()->default_value("false"))
             ("no-cpu", "Do not record CPU stats", cxxopts::value<bool>()->default_value("false"))
             ("p,pid", "Track CPUs assigned to process or thread with PID",cxxopts::value<std::vector<int>>())
             ("P,all-pids", "Track CPUs assigned to all processes or threads", cxxopts::value<bool>()->default_value("false"))
+            ("top", "Show only N tasks with the highest CPU usage per interval, 0 to show all",
+                    cxxopts::value<int>()->default_value("0"))
+            ("runq", "With --all-pids, count tasks in R and D state per CPU (run queue depth)",
+                    cxxopts::value<bool>()->default_value("false"))
+            ("placement-file", "Count migrations of tracked threads and write thread x CPU residency matrix to this CSV file, "
+                               "a row per thread when it exits or at the end of the run",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("affinity-check", "Flag tracked threads found on CPUs outside the affinity they had when first seen",
+                    cxxopts::value<bool>()->default_value("false"))
+            ("reserved-cpus", "With --affinity-check and -P, --comm or --cgroup, also flag threads other than given with -p "
+                              "found on these CPUs (e.g. \"2-3\")",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("comm", "Track CPUs assigned to processes with command name matching the regex", cxxopts::value<std::string>())
+            ("cgroup", "Track CPUs assigned to threads of the cgroup (v2) directory", cxxopts::value<std::string>())
+            ("pid-perf", "Attach perf counters (on-CPU time, switches, migrations, IPC) to tracked threads",
+                    cxxopts::value<bool>()->default_value("false"))
+            ("profile", "Sample call stacks of threads given with -p and write collapsed stacks on exit",
+                    cxxopts::value<bool>()->default_value("false"))
+            ("profile-file", "File name for collapsed stacks (flamegraph input)", cxxopts::value<std::string>()->default_value("profile.folded"))
+            ("profile-freq", "Profiler sampling frequency in Hz", cxxopts::value<int>()->default_value("99"))
+            ("d-state-ms", "Report tracked threads staying in uninterruptible sleep (D state) longer than this, 0 to disable",
+                    cxxopts::value<int>()->default_value("0"))
+            ("d-state-file", "CSV file name to record D state events, stderr if not given", cxxopts::value<std::string>()->default_value(""))
+            ("tree", "Aggregate CPU usage of the process with PID and all its descendants", cxxopts::value<std::vector<int>>())
+            ("tree-children", "Also show CPU usage of each process in the tree", cxxopts::value<bool>()->default_value("false"))
+            ("tree-file", "CSV file name to record process tree stats", cxxopts::value<std::string>()->default_value(""))
+            ("uid-file", "CSV file name to record CPU usage of tracked tasks grouped by user", cxxopts::value<std::string>()->default_value(""))
+            ("comm-file", "CSV file name to record CPU usage of tracked tasks grouped by command name",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("group-top", "Number of busiest users or commands to record per interval, 0 for all",
+                    cxxopts::value<int>()->default_value("10"))
+            ("isolation", "Report tracked tasks (use with -P) and interrupts time on isolated (isolcpus, nohz_full) CPUs",
+                    cxxopts::value<bool>()->default_value("false"))
+            ("isolated-cpus", "CPUs to watch instead of isolated ones from sysfs (e.g. \"2-3\")",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("isolation-allow", "Command name prefixes of tasks allowed on isolated CPUs",
+                    cxxopts::value<std::vector<std::string>>()->default_value(
+                            "swapper,ksoftirqd/,kworker/,migration/,cpuhp/,rcuc/,rcuop/,idle_inject/"))
+            ("isolation-file", "CSV file name to record isolated CPUs interference, stderr if not given",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("attrib-file", "CSV file name to record threads contributing most to the busy time of each CPU",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("attrib-top", "Number of threads to record per CPU", cxxopts::value<int>()->default_value("3"))
             ("f,file", "Base name for CSV files where to record results", cxxopts::value<std::string>()->default_value(""))
             ("cpu-file", "CSV file name to record CPU stats", cxxopts::value<std::string>()->default_value(""))
             ("pid-file", "CSV file name to record PID stats", cxxopts::value<std::string>()->default_value(""))
+            ("cpuidle-file", "CSV file name to record CPU idle states residency", cxxopts::value<std::string>()->default_value(""))
+            ("pressure-file", "CSV file name to record CPU, memory and IO pressure stall stats", cxxopts::value<std::string>()->default_value(""))
+            ("pressure-cgroup", "Also record pressure stall stats of the cgroup with the given path", cxxopts::value<std::vector<std::string>>())
+            ("pressure-trigger", "Register PSI trigger (e.g. \"some 150000 1000000\") and record pressure stats as soon as it fires",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("cgroup-tree", "Record cpu.stat of all cgroups (v2) under the given directory", cxxopts::value<std::string>()->default_value("/sys/fs/cgroup"))
+            ("cgroup-file", "CSV file name to record cgroups CPU usage and throttling", cxxopts::value<std::string>()->default_value(""))
+            ("container", "Record only CPUs of the cgroup cpuset and utilization relative to the cgroup CPU quota",
+                    cxxopts::value<bool>()->default_value("false"))
+            ("perf-cpu-file", "CSV file name to record per-CPU perf counters (context switches, migrations, faults)",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("perf-hw", "Also count hardware cycles and instructions, where available", cxxopts::value<bool>()->default_value("false"))
+            ("backend", "Force data sources backends, comma-separated: getdents or readdir to list PIDs, "
+                        "read or stream to read /proc files (auto selects the fastest available)",
+                    cxxopts::value<std::string>()->default_value("auto"))
+            ("control", "Unix socket to accept commands on while running: add-pid PID, remove-pid PID, "
+                        "interval MS, enable NAME, disable NAME, consumers",
+                    cxxopts::value<std::string>()->default_value(""))
+            ("proc-root", "Directory to read procfs from, e.g. host /proc mounted into a container",
+                    cxxopts::value<std::string>()->default_value("/proc"))
+            ("sys-root", "Directory to read sysfs from (cgroup tree defaults to <sys-root>/fs/cgroup)",
+                    cxxopts::value<std::string>()->default_value("/sys"))
             ("ncu,normalize-cpu-utility", "Write CPU load in normal form, 0 <= utility <= 1, instead of percents",
                     cxxopts::value<bool>()->default_value("false"))
             ("h,help", "Print usage")
@@ -70,12 +304,60 @@ cxxopts::Options BuildOptions() {
 Settings BuildSettings(const cxxopts::ParseResult& args) {
     Settings settings{};
     if (args.count("interval")) {
-        settings.interval_ms = args["interval"].as<int>();
-        if (settings.interval_ms <= 0) {
-            std::cerr << "Bad interval, must be non-negative\n";
+        settings.interval_ms = args["interval"].as<double>();
+        if (!(settings.interval_ms >= 0.1)) {
+            std::cerr << "Bad interval, must be at least 0.1 ms\n";
             std::exit(1);
         }
     }
+    settings.align_ticks = args.count("align") > 0;
+    settings.sample_threads = args["sample-threads"].as<int>();
+    if (settings.sample_threads < 0) {
+        std::cerr << "Bad number of sampling threads, must not be negative\n";
+        std::exit(1);
+    }
+    if (args.count("tick-file")) {
+        settings.tick_stats_file_name = args["tick-file"].as<std::string>();
+    }
+    settings.inline_consumers = args.count("inline-consumers") > 0;
+    settings.ring_size = args["ring-size"].as<int>();
+    if (settings.ring_size < 2) {
+        std::cerr << "Bad ring size, must be at least 2\n";
+        std::exit(1);
+    }
+    if (args.count("slow-consumer")) {
+        for (auto const& item: args["slow-consumer"].as<std::vector<std::string>>()) {
+            auto pos = item.find('=');
+            auto policy = ParseSlowConsumerPolicy(pos == std::string::npos ? item : item.substr(pos + 1));
+            if (!policy) {
+                std::cerr << "Bad slow consumer policy \"" << item << "\", expected block, drop-oldest or coalesce\n";
+                std::exit(1);
+            }
+            if (pos == std::string::npos) {
+                settings.slow_consumer_policy = *policy;
+            } else {
+                settings.slow_consumer_policies[item.substr(0, pos)] = *policy;
+            }
+        }
+    }
+    if (args.count("period")) {
+        for (auto const& item: args["period"].as<std::vector<std::string>>()) {
+            auto pos = item.find('=');
+            auto source = item.substr(0, pos);
+            bool known{false};
+            for (int i{}; i <= static_cast<int>(Source::process_tree); i++) {
+                known |= source == ToString(static_cast<Source>(i));
+            }
+            double period_ms{};
+            if (pos == std::string::npos || !known ||
+                !(std::istringstream{item.substr(pos + 1)} >> period_ms) || period_ms < 0) {
+                std::cerr << "Bad period \"" << item << "\", expected SOURCE=MS with SOURCE one of "
+                             "cpu, pid, cpuidle, pressure, cgroup, perf-cpu, profile, tree\n";
+                std::exit(1);
+            }
+            settings.periods_ms[source] = period_ms;
+        }
+    }
     settings.use_cpu_stats = !args.count("no-cpu");
     if (args.count("pid")) {
         for (int pid: args["pid"].as<std::vector<int>>()) {
@@ -85,6 +367,93 @@ Settings BuildSettings(const cxxopts::ParseResult& args) {
     if (args.count("all-pids")) {
         settings.all_pids = true;
     }
+    settings.top_pids = args["top"].as<int>();
+    if (settings.top_pids < 0) {
+        std::cerr << "Bad number of top tasks, must be non-negative\n";
+        std::exit(1);
+    }
+    if (args.count("runq")) {
+        settings.run_queue = true;
+    }
+    if (args.count("placement-file")) {
+        settings.placement_file_name = args["placement-file"].as<std::string>();
+    }
+    if (args.count("affinity-check")) {
+        settings.affinity_check = true;
+    }
+    if (args.count("reserved-cpus")) {
+        settings.reserved_cpus = ParseCpuList(args["reserved-cpus"].as<std::string>().c_str());
+    }
+    if (args.count("comm")) {
+        settings.comm_pattern = args["comm"].as<std::string>();
+    }
+    if (args.count("cgroup")) {
+        settings.pids_cgroup = args["cgroup"].as<std::string>();
+    }
+    // Only threads found beyond those given with -p can be foreign to reserved CPUs
+    if (!settings.reserved_cpus.empty() && !settings.all_pids &&
+        settings.comm_pattern.empty() && settings.pids_cgroup.empty()) {
+        std::cerr << "Reserved CPUs need threads to check besides -p (-P, --comm or --cgroup)\n";
+        std::exit(1);
+    }
+    if (args.count("pid-perf")) {
+        settings.pids_perf = true;
+    }
+    if (args.count("profile")) {
+        settings.profile = true;
+    }
+    settings.profile_file_name = args["profile-file"].as<std::string>();
+    settings.profile_frequency = args["profile-freq"].as<int>();
+    if (settings.profile_frequency <= 0) {
+        std::cerr << "Bad profiler frequency, must be positive\n";
+        std::exit(1);
+    }
+    settings.d_state_threshold_ms = args["d-state-ms"].as<int>();
+    if (settings.d_state_threshold_ms < 0) {
+        std::cerr << "Bad D state threshold, must be non-negative\n";
+        std::exit(1);
+    }
+    if (args.count("d-state-file")) {
+        settings.d_state_file_name = args["d-state-file"].as<std::string>();
+    }
+    if (args.count("tree")) {
+        settings.tree_pids = args["tree"].as<std::vector<int>>();
+    }
+    if (args.count("tree-children")) {
+        settings.tree_children = true;
+    }
+    if (args.count("tree-file")) {
+        settings.tree_stats_file_name = args["tree-file"].as<std::string>();
+    }
+    if (args.count("uid-file")) {
+        settings.uid_stats_file_name = args["uid-file"].as<std::string>();
+    }
+    if (args.count("comm-file")) {
+        settings.comm_stats_file_name = args["comm-file"].as<std::string>();
+    }
+    settings.group_top = args["group-top"].as<int>();
+    if (settings.group_top < 0) {
+        std::cerr << "Bad number of groups, must be non-negative\n";
+        std::exit(1);
+    }
+    if (args.count("isolation")) {
+        settings.isolation = true;
+    }
+    if (args.count("isolated-cpus")) {
+        settings.isolated_cpus = ParseCpuList(args["isolated-cpus"].as<std::string>().c_str());
+    }
+    settings.isolation_allowed_comms = args["isolation-allow"].as<std::vector<std::string>>();
+    if (args.count("isolation-file")) {
+        settings.isolation_file_name = args["isolation-file"].as<std::string>();
+    }
+    if (args.count("attrib-file")) {
+        settings.attribution_file_name = args["attrib-file"].as<std::string>();
+    }
+    settings.attribution_top = args["attrib-top"].as<int>();
+    if (settings.attribution_top <= 0) {
+        std::cerr << "Bad number of threads per CPU, must be positive\n";
+        std::exit(1);
+    }
     if (args.count("file")) {
         auto file_name = args["file"].as<std::string>();
         if (!file_name.empty()) {
@@ -98,9 +467,41 @@ Settings BuildSettings(const cxxopts::ParseResult& args) {
     if (args.count("pid-file")) {
         settings.pid_stats_file_name = args["pid-file"].as<std::string>();
     }
+    if (args.count("cpuidle-file")) {
+        settings.cpuidle_stats_file_name = args["cpuidle-file"].as<std::string>();
+    }
+    if (args.count("pressure-file")) {
+        settings.pressure_stats_file_name = args["pressure-file"].as<std::string>();
+    }
+    if (args.count("pressure-cgroup")) {
+        settings.pressure_cgroups = args["pressure-cgroup"].as<std::vector<std::string>>();
+    }
+    if (args.count("pressure-trigger")) {
+        settings.pressure_trigger = args["pressure-trigger"].as<std::string>();
+    }
+    settings.control_socket_path = args["control"].as<std::string>();
+    settings.proc_root = args["proc-root"].as<std::string>();
+    settings.sys_root = args["sys-root"].as<std::string>();
+    settings.cgroup_tree = args["cgroup-tree"].as<std::string>();
+    if (!args.count("cgroup-tree") && args.count("sys-root")) {
+        settings.cgroup_tree = settings.sys_root + "/fs/cgroup";
+    }
+    if (args.count("cgroup-file")) {
+        settings.cgroup_stats_file_name = args["cgroup-file"].as<std::string>();
+    }
+    settings.backend = args["backend"].as<std::string>();
     if (args.count("normalize-cpu-utility")) {
         settings.normalize_cpu_utility = true;
     }
+    if (args.count("container")) {
+        settings.container = true;
+    }
+    if (args.count("perf-cpu-file")) {
+        settings.perf_cpu_stats_file_name = args["perf-cpu-file"].as<std::string>();
+    }
+    if (args.count("perf-hw")) {
+        settings.perf_hardware_events = true;
+    }
     return settings;
 }
 
@@ -109,36 +510,169 @@ void PrintHelp(const cxxopts::Options& options) {
 }
 
 
-void MainLoop(
-        int interval_ms,
-        std::vector<std::shared_ptr<Manager>> const& managers_list,
-        std::vector<std::shared_ptr<Consumer>> const& consumers_list
-) {
-    for (auto const& consumer: consumers_list) consumer->Start();
-    while (true) {
-        {
-            std::unique_lock lock{should_stop_m};
-            should_stop_cv.wait_for(
-                    lock, std::chrono::milliseconds(interval_ms),
-                    []() { return should_stop; });
-            if (should_stop) break;
-        }
-        for (auto const& consumer: consumers_list) consumer->BeginIter();
-        for (auto const& manager: managers_list) manager->Update();
-        for (auto const& consumer: consumers_list) consumer->EndIter();
-    }
-    for (auto const& consumer: consumers_list) consumer->Finish();
+/**
+ * Sources the main loop waits for, and objects that control socket
+ * commands change between ticks.
+ */
+struct LoopState {
+    EventLoop events{};
+    IntervalTimer timer{};
+    Scheduler scheduler{};
+    ControlSocket control{};
+    int signal_fd{-1};
+    bool align_ticks{false};
+    std::shared_ptr<PidManager> pid_manager{};
+    std::map<std::string, std::shared_ptr<Consumer>> consumers_by_name{};
+};
+
+
+std::chrono::nanoseconds IntervalFromMs(double interval_ms) {
+    return std::chrono::nanoseconds{std::llround(interval_ms * 1e6)};
 }
 
 
-void HandleSignal(int signo) {
-    if (signo == SIGINT || signo == SIGTERM) {
-        std::lock_guard lock{should_stop_m};
-        should_stop = true;
-        should_stop_cv.notify_all();
+/** Execute a control socket command, returns the reply line */
+std::string ApplyCommand(std::string const& command, LoopState& state) {
+    std::istringstream ss{command};
+    std::string name{};
+    ss >> name;
+    if (name == "add-pid" || name == "remove-pid") {
+        int pid{};
+        if (!(ss >> pid) || pid <= 0) {
+            return "error: bad PID";
+        }
+        if (!state.pid_manager || state.pid_manager->is_tracking_all()) {
+            return "error: PIDs are not tracked individually (start with -p)";
+        }
+        auto const& pids = state.pid_manager->pids();
+        bool tracked = std::find(pids.begin(), pids.end(), pid) != pids.end();
+        if (name == "add-pid" && !tracked) {
+            state.pid_manager->add_pid(pid);
+        } else if (name == "remove-pid" && !state.pid_manager->remove_pid(pid)) {
+            return "error: PID is not tracked";
+        }
+        return "ok";
+    }
+    if (name == "interval") {
+        double interval_ms{};
+        if (!(ss >> interval_ms) || !(interval_ms >= 0.1)) {
+            return "error: bad interval, must be at least 0.1 ms";
+        }
+        if (!state.timer.Start(IntervalFromMs(interval_ms), state.align_ticks)) {
+            return "error: can not arm timer";
+        }
+        state.scheduler.set_interval(IntervalFromMs(interval_ms));
+        return "ok";
+    }
+    if (name == "enable" || name == "disable") {
+        std::string consumer_name{};
+        ss >> consumer_name;
+        auto it = state.consumers_by_name.find(consumer_name);
+        if (it == state.consumers_by_name.end()) {
+            return "error: unknown consumer " + consumer_name;
+        }
+        it->second->set_enabled(name == "enable");
+        return "ok";
+    }
+    if (name == "consumers") {
+        std::string reply{};
+        for (auto const& [consumer_name, consumer]: state.consumers_by_name) {
+            reply += consumer_name + (consumer->is_enabled() ? ":on " : ":off ");
+        }
+        return reply;
+    }
+    return "error: unknown command " + name;
+}
+
+
+void HandleControlClient(int fd, LoopState& state) {
+    std::vector<std::string> commands{};
+    bool connected = state.control.ReadCommands(fd, commands);
+    for (auto const& command: commands) {
+        state.control.Reply(fd, ApplyCommand(command, state));
+    }
+    if (!connected) {
+        state.events.Remove(fd);
+        state.control.CloseClient(fd);
     }
 }
 
+
+void MainLoop(
+        std::chrono::nanoseconds interval,
+        LoopState& state,
+        ConsumerPipeline& pipeline
+) {
+    pipeline.Start();
+    state.scheduler.set_interval(interval);
+    bool running = state.timer.Start(interval, state.align_ticks);
+    while (running) {
+        // Managers due on a tick, pressure early on a PSI trigger (wakeup), and all of them on SIGUSR1
+        uint64_t ticks{};
+        bool pressure{false};
+        bool sample{false};
+        for (int fd: state.events.Wait()) {
+            if (fd == state.timer.fd()) {
+                ticks += state.timer.ReadTicks();
+            } else if (fd == state.events.wakeup_fd()) {
+                pressure = true;
+            } else if (fd == state.signal_fd) {
+                signalfd_siginfo info{};
+                if (::read(state.signal_fd, &info, sizeof(info)) != sizeof(info)) {
+                    continue;
+                }
+                if (info.ssi_signo == SIGUSR1) {
+                    sample = true;
+                } else {
+                    running = false;
+                }
+            } else if (fd == state.control.fd()) {
+                for (int client; (client = state.control.AcceptClient()) >= 0; ) {
+                    state.events.Add(client);
+                }
+            } else if (state.control.is_client(fd)) {
+                HandleControlClient(fd, state);
+            }
+        }
+        if (!running || !(ticks > 0 || pressure || sample)) {
+            continue;
+        }
+        SourceSet refreshed{};
+        if (sample) {
+            refreshed = state.scheduler.DueAll();
+        } else {
+            if (ticks > 0) {
+                refreshed = state.scheduler.Advance(ticks);
+            } else {
+                state.scheduler.ClearDue();
+            }
+            if (pressure) {
+                // Other managers keep their periods, e.g. the all-pids scan is not run under pressure
+                refreshed = state.scheduler.AddDue(Source::pressure);
+            }
+        }
+        if (refreshed.empty()) {
+            continue;
+        }
+        pipeline.BeginIter(refreshed);
+        state.scheduler.Update();
+        pipeline.EndIter(refreshed);
+    }
+    // Values managers are left with (folded stacks, residency of running threads) are
+    // recorded as a last iteration, consumers take them on their own threads before finishing
+    pipeline.BeginIter({});
+    for (auto const& manager: state.scheduler.managers()) {
+        manager->Finish();
+    }
+    pipeline.EndIter({});
+    pipeline.Finish();
+    if (state.timer.missed_ticks() > 0) {
+        std::cerr << state.timer.missed_ticks() << " ticks were skipped, "
+                     "iterations took longer than the interval\n";
+    }
+}
+
+
 int main(int argc, char **argv) {
     auto options = BuildOptions();
     auto parsed = options.parse(argc, argv);
@@ -149,40 +683,203 @@ int main(int argc, char **argv) {
     auto settings = BuildSettings(parsed);
     std::cout << settings.String();
 
+    /*
+     * Signals are received through signalfd by the main loop, so they are
+     * blocked before any thread is started and inherits the mask
+     */
+    sigset_t signals{};
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    LoopState loop_state{};
+    loop_state.align_ticks = settings.align_ticks;
+    loop_state.signal_fd = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (loop_state.signal_fd < 0 || !loop_state.events.Open() || !loop_state.timer.Open() ||
+        !loop_state.events.Add(loop_state.signal_fd) || !loop_state.events.Add(loop_state.timer.fd())) {
+        std::cerr << "Error setting up the main loop\n";
+        std::exit(1);
+    }
+    if (!settings.control_socket_path.empty()) {
+        if (!loop_state.control.Open(settings.control_socket_path) || !loop_state.events.Add(loop_state.control.fd())) {
+            std::exit(1);
+        }
+    }
+
+    if (!ProcRoot::Instance().Open(settings.proc_root, settings.sys_root)) {
+        std::cerr << "Error opening " << settings.proc_root << " or " << settings.sys_root << "\n";
+        std::exit(1);
+    }
+
+    /*
+     * Probe kernel interfaces once and choose the fastest backends
+     */
+    auto capabilities = ProbeBackends();
+    auto backends = SelectBackends(capabilities);
+    if (!OverrideBackends(settings.backend, backends)) {
+        std::cerr << "Bad backend list: " << settings.backend << "\n";
+        std::exit(1);
+    }
+    SetProcBackends(backends.proc_list, backends.proc_read);
+    std::cout << capabilities.String() << backends.String();
+
     std::vector<std::shared_ptr<Manager>> managers{};
-    std::vector<std::shared_ptr<Consumer>> consumers{};
+    ConsumerPipeline pipeline{!settings.inline_consumers, static_cast<size_t>(settings.ring_size)};
+    // Named for enable/disable control commands and slow consumer policies
+    auto add_consumer = [&pipeline, &settings, &loop_state](std::string const& name, std::shared_ptr<Consumer> consumer) {
+        auto it = settings.slow_consumer_policies.find(name);
+        auto policy = it != settings.slow_consumer_policies.end() ? it->second : settings.slow_consumer_policy;
+        pipeline.add_consumer(name, consumer, policy);
+        loop_state.consumers_by_name.emplace(name, std::move(consumer));
+    };
     int num_cpus = GetCpuCount();
 
+    /*
+     * In container mode, find own cgroup, its effective cpuset and CPU limit
+     */
+    std::string self_cgroup{};
+    std::vector<int> cpus{};
+    double cpu_limit{};
+    if (settings.container) {
+        self_cgroup = GetSelfCgroupPath();
+        cpus = ReadCgroupEffectiveCpus(self_cgroup);
+        cpu_limit = static_cast<double>(cpus.size());
+        if (auto quota = ReadCgroupCpuLimit(self_cgroup); quota && *quota < cpu_limit) {
+            cpu_limit = *quota;
+        }
+        if (self_cgroup.empty()) {
+            std::cerr << "cgroup v2 is not mounted, CPU quota will not be taken into account\n";
+        }
+        std::cout << "cgroup: " << self_cgroup << ", cpus: " << cpus.size()
+                  << ", cpu limit: " << cpu_limit << std::endl;
+    }
+
     /*
      * Create managers
      */
     auto cpu_manager = std::make_shared<CpuManager>();
+    if (settings.container) {
+        cpu_manager->set_cpus(cpus);
+        if (!self_cgroup.empty()) {
+            cpu_manager->set_cgroup(self_cgroup, cpu_limit);
+        }
+    }
     managers.push_back(cpu_manager);
 
+    if (settings.run_queue && !settings.all_pids) {
+        std::cerr << "Run queue depth needs --all-pids\n";
+    }
+    // Managers that scan /proc share a single pass per tick
+    auto proc_scan = std::make_shared<ProcScan>();
+    bool track_pids = !settings.pids.empty() || settings.all_pids ||
+            !settings.comm_pattern.empty() || !settings.pids_cgroup.empty();
     std::shared_ptr<PidManager> pid_manager{};
-    if (!settings.pids.empty() || settings.all_pids) {
+    if (track_pids) {
         pid_manager = std::make_shared<PidManager>();
+        pid_manager->set_proc_scan(proc_scan);
         for (auto pid: settings.pids) {
             pid_manager->add_pid(pid);
         }
         if (settings.all_pids) {
             pid_manager->set_track_all(true);
         }
+        if (!settings.comm_pattern.empty()) {
+            try {
+                pid_manager->set_comm_filter(settings.comm_pattern);
+            } catch (std::regex_error const& e) {
+                std::cerr << "Bad comm pattern: " << e.what() << "\n";
+                std::exit(1);
+            }
+        }
+        if (!settings.pids_cgroup.empty()) {
+            pid_manager->set_cgroup_filter(settings.pids_cgroup);
+        }
+        pid_manager->set_perf_counters(settings.pids_perf);
+        pid_manager->set_run_queue_stats(settings.run_queue && settings.all_pids);
+        pid_manager->set_placement_tracking(!settings.placement_file_name.empty());
+        pid_manager->set_affinity_check(settings.affinity_check);
+        pid_manager->set_reserved_cpus(settings.reserved_cpus);
         managers.push_back(pid_manager);
     }
 
+    std::shared_ptr<CpuIdleManager> cpuidle_manager{};
+    if (!settings.cpuidle_stats_file_name.empty()) {
+        cpuidle_manager = std::make_shared<CpuIdleManager>();
+        managers.push_back(cpuidle_manager);
+    }
+
+    std::shared_ptr<PressureManager> pressure_manager{};
+    if (!settings.pressure_stats_file_name.empty()) {
+        pressure_manager = std::make_shared<PressureManager>();
+        for (auto const& cgroup: settings.pressure_cgroups) {
+            pressure_manager->add_cgroup(cgroup);
+        }
+        if (!settings.pressure_trigger.empty()) {
+            pressure_manager->set_trigger(settings.pressure_trigger);
+            pressure_manager->set_trigger_callback([&loop_state]() {
+                loop_state.events.Wakeup();
+            });
+        }
+        managers.push_back(pressure_manager);
+    }
+
+    std::shared_ptr<CgroupManager> cgroup_manager{};
+    if (!settings.cgroup_stats_file_name.empty()) {
+        cgroup_manager = std::make_shared<CgroupManager>();
+        cgroup_manager->set_root(settings.cgroup_tree);
+        managers.push_back(cgroup_manager);
+    }
+
+    std::shared_ptr<PerfCpuManager> perf_cpu_manager{};
+    if (!settings.perf_cpu_stats_file_name.empty()) {
+        perf_cpu_manager = std::make_shared<PerfCpuManager>();
+        perf_cpu_manager->set_hardware_events(settings.perf_hardware_events);
+        managers.push_back(perf_cpu_manager);
+    }
+
+    std::shared_ptr<ProfileManager> profile_manager{};
+    if (settings.profile) {
+        if (settings.pids.empty()) {
+            std::cerr << "Profiler needs threads given with -p\n";
+        } else {
+            profile_manager = std::make_shared<ProfileManager>();
+            profile_manager->set_frequency(settings.profile_frequency);
+            for (auto pid: settings.pids) {
+                profile_manager->add_pid(pid);
+            }
+            managers.push_back(profile_manager);
+        }
+    }
+
+    std::shared_ptr<ProcessTreeManager> process_tree_manager{};
+    if (!settings.tree_pids.empty()) {
+        process_tree_manager = std::make_shared<ProcessTreeManager>();
+        process_tree_manager->set_proc_scan(proc_scan);
+        for (int pid: settings.tree_pids) {
+            process_tree_manager->add_root(pid);
+        }
+        process_tree_manager->set_children_breakdown(settings.tree_children);
+        managers.push_back(process_tree_manager);
+    }
+
     /* Create consumers */
     // 1) Table
     Table::Settings table_props{};
     table_props.show_cpu_stats = true;
-    table_props.show_pid_stats = !settings.pids.empty() || settings.all_pids;
+    table_props.show_pid_stats = track_pids || process_tree_manager;
     table_props.num_cpus = num_cpus;
+    table_props.cpus = cpus;
+    table_props.show_quota_util = settings.container && !self_cgroup.empty();
+    table_props.top_pids = settings.top_pids;
+    table_props.show_run_queue = settings.run_queue && settings.all_pids;
     table_props.show_outer_delims = true;
     table_props.show_heading = true;
     table_props.show_divider = false;
     table_props.normalize_cpu_utility = settings.normalize_cpu_utility;
     auto table = std::make_shared<Table>(table_props);
-    consumers.push_back(table);
+    add_consumer("table", table);
 
     // 2) CPU utility CSV
     std::shared_ptr<CpuUtilCsvWriter> cpu_util_csv{};
@@ -190,9 +887,15 @@ int main(int argc, char **argv) {
         cpu_util_csv = std::make_shared<CpuUtilCsvWriter>();
         cpu_util_csv->set_stream(std::ofstream(settings.cpu_stats_file_name, std::ios::out));
         cpu_util_csv->enable_header(true);
-        cpu_util_csv->set_num_cpus(num_cpus);
+        if (settings.container) {
+            cpu_util_csv->set_cpus(cpus);
+            cpu_util_csv->enable_quota_util(!self_cgroup.empty());
+        } else {
+            cpu_util_csv->set_num_cpus(num_cpus);
+        }
+        cpu_util_csv->enable_run_queue(settings.run_queue && settings.all_pids);
         cpu_util_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
-        consumers.push_back(cpu_util_csv);
+        add_consumer("cpu", cpu_util_csv);
     }
 
     // 3) PID CPU CSV
@@ -201,40 +904,260 @@ int main(int argc, char **argv) {
         pid_cpu_csv = std::make_shared<PidCpuCsvWriter>();
         pid_cpu_csv->set_stream(std::ofstream{settings.pid_stats_file_name, std::ios::out});
         pid_cpu_csv->enable_header(true);
-        consumers.push_back(pid_cpu_csv);
+        pid_cpu_csv->enable_perf_columns(settings.pids_perf && !settings.all_pids);
+        pid_cpu_csv->enable_migration_columns(!settings.placement_file_name.empty());
+        pid_cpu_csv->enable_affinity_column(settings.affinity_check);
+        add_consumer("pid", pid_cpu_csv);
+    }
+
+    // 4) CPU idle states CSV
+    std::shared_ptr<CpuIdleCsvWriter> cpuidle_csv{};
+    if (cpuidle_manager) {
+        cpuidle_csv = std::make_shared<CpuIdleCsvWriter>();
+        cpuidle_csv->set_stream(std::ofstream{settings.cpuidle_stats_file_name, std::ios::out});
+        cpuidle_csv->enable_header(true);
+        cpuidle_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+        add_consumer("cpuidle", cpuidle_csv);
+    }
+
+    // 5) Pressure stall CSV
+    std::shared_ptr<PressureCsvWriter> pressure_csv{};
+    if (pressure_manager) {
+        pressure_csv = std::make_shared<PressureCsvWriter>();
+        pressure_csv->set_stream(std::ofstream{settings.pressure_stats_file_name, std::ios::out});
+        pressure_csv->enable_header(true);
+        pressure_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+        add_consumer("pressure", pressure_csv);
+    }
+
+    // 6) Cgroups CSV
+    std::shared_ptr<CgroupCsvWriter> cgroup_csv{};
+    if (cgroup_manager) {
+        cgroup_csv = std::make_shared<CgroupCsvWriter>();
+        cgroup_csv->set_stream(std::ofstream{settings.cgroup_stats_file_name, std::ios::out});
+        cgroup_csv->enable_header(true);
+        cgroup_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+        add_consumer("cgroup", cgroup_csv);
+    }
+
+    // 7) Per-CPU perf counters CSV
+    std::shared_ptr<PerfCpuCsvWriter> perf_cpu_csv{};
+    if (perf_cpu_manager) {
+        perf_cpu_csv = std::make_shared<PerfCpuCsvWriter>();
+        perf_cpu_csv->set_stream(std::ofstream{settings.perf_cpu_stats_file_name, std::ios::out});
+        perf_cpu_csv->enable_header(true);
+        perf_cpu_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+        add_consumer("perf-cpu", perf_cpu_csv);
+    }
+
+    // 8) Profiler collapsed stacks
+    std::shared_ptr<FoldedStacksWriter> folded_stacks{};
+    if (profile_manager) {
+        folded_stacks = std::make_shared<FoldedStacksWriter>(
+                std::ofstream{settings.profile_file_name, std::ios::out});
+        add_consumer("profile", folded_stacks);
+    }
+
+    // 9) D state watchdog
+    std::shared_ptr<DStateWatchdog> d_state_watchdog{};
+    if (settings.d_state_threshold_ms > 0) {
+        if (!pid_manager) {
+            std::cerr << "D state watchdog needs tracked threads (-p, -P, --comm or --cgroup)\n";
+        } else {
+            d_state_watchdog = std::make_shared<DStateWatchdog>();
+            if (settings.d_state_file_name.empty()) {
+                d_state_watchdog->set_stream(std::cerr);
+            } else {
+                d_state_watchdog->set_stream(std::ofstream{settings.d_state_file_name, std::ios::out});
+            }
+            d_state_watchdog->enable_header(true);
+            d_state_watchdog->set_threshold(std::chrono::milliseconds(settings.d_state_threshold_ms));
+            add_consumer("d-state", d_state_watchdog);
+        }
+    }
+
+    // 10) Process trees CSV
+    std::shared_ptr<ProcessTreeCsvWriter> tree_csv{};
+    if (process_tree_manager && !settings.tree_stats_file_name.empty()) {
+        tree_csv = std::make_shared<ProcessTreeCsvWriter>();
+        tree_csv->set_stream(std::ofstream{settings.tree_stats_file_name, std::ios::out});
+        tree_csv->enable_header(true);
+        tree_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+        add_consumer("tree", tree_csv);
+    }
+
+    // 11) Per-user and per-command CPU usage CSV
+    std::shared_ptr<UidGroupCsvWriter> uid_csv{};
+    std::shared_ptr<CommGroupCsvWriter> comm_csv{};
+    if (!settings.uid_stats_file_name.empty() || !settings.comm_stats_file_name.empty()) {
+        if (!pid_manager) {
+            std::cerr << "Grouping by user or command needs tracked threads (-p, -P, --comm or --cgroup)\n";
+        } else {
+            if (!settings.uid_stats_file_name.empty()) {
+                uid_csv = std::make_shared<UidGroupCsvWriter>();
+                uid_csv->set_stream(std::ofstream{settings.uid_stats_file_name, std::ios::out});
+                uid_csv->enable_header(true);
+                uid_csv->set_top(settings.group_top);
+                uid_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+                add_consumer("uid", uid_csv);
+            }
+            if (!settings.comm_stats_file_name.empty()) {
+                comm_csv = std::make_shared<CommGroupCsvWriter>();
+                comm_csv->set_stream(std::ofstream{settings.comm_stats_file_name, std::ios::out});
+                comm_csv->enable_header(true);
+                comm_csv->set_top(settings.group_top);
+                comm_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+                add_consumer("comm", comm_csv);
+            }
+        }
+    }
+
+    // 12) Attribution of CPU busy time to threads CSV
+    std::shared_ptr<CpuAttributionCsvWriter> attribution_csv{};
+    if (!settings.attribution_file_name.empty()) {
+        if (!pid_manager) {
+            std::cerr << "CPU time attribution needs tracked threads (-p, -P, --comm or --cgroup)\n";
+        } else {
+            attribution_csv = std::make_shared<CpuAttributionCsvWriter>();
+            attribution_csv->set_stream(std::ofstream{settings.attribution_file_name, std::ios::out});
+            attribution_csv->enable_header(true);
+            attribution_csv->set_top(settings.attribution_top);
+            attribution_csv->set_normalize_cpu_utility(settings.normalize_cpu_utility);
+            add_consumer("attrib", attribution_csv);
+        }
+    }
+
+    // 13) Thread x CPU residency matrix CSV
+    std::shared_ptr<PlacementMatrixCsvWriter> placement_csv{};
+    if (pid_manager && !settings.placement_file_name.empty()) {
+        placement_csv = std::make_shared<PlacementMatrixCsvWriter>();
+        placement_csv->set_stream(std::ofstream{settings.placement_file_name, std::ios::out});
+        placement_csv->enable_header(true);
+        placement_csv->set_num_cpus(num_cpus);
+        add_consumer("placement", placement_csv);
+    }
+
+    // 14) Isolated CPUs interference
+    std::shared_ptr<IsolationWatchdog> isolation_watchdog{};
+    if (settings.isolation) {
+        auto isolated_cpus = settings.isolated_cpus.empty() ? LoadIsolatedCpus() : settings.isolated_cpus;
+        std::erase_if(isolated_cpus, [num_cpus](int cpu) { return cpu >= num_cpus; });
+        if (isolated_cpus.empty()) {
+            std::cerr << "No isolated CPUs found, isolation watchdog is disabled\n";
+        } else {
+            isolation_watchdog = std::make_shared<IsolationWatchdog>();
+            if (settings.isolation_file_name.empty()) {
+                isolation_watchdog->set_stream(std::cerr);
+            } else {
+                isolation_watchdog->set_stream(std::ofstream{settings.isolation_file_name, std::ios::out});
+            }
+            isolation_watchdog->enable_header(true);
+            isolation_watchdog->set_isolated_cpus(isolated_cpus);
+            isolation_watchdog->set_allowed_comms(settings.isolation_allowed_comms);
+            add_consumer("isolation", isolation_watchdog);
+        }
+    }
+
+    // 15) Tick timing CSV
+    std::shared_ptr<TickCsvWriter> tick_csv{};
+    if (!settings.tick_stats_file_name.empty()) {
+        tick_csv = std::make_shared<TickCsvWriter>();
+        tick_csv->set_stream(std::ofstream{settings.tick_stats_file_name, std::ios::out});
+        tick_csv->enable_header(true);
+        add_consumer("tick", tick_csv);
     }
 
     /* Bind consumers to managers */
-    cpu_manager->add_acceptor(dynamic_pointer_cast<CpuInfoAcceptor>(table));
-    cpu_manager->add_acceptor(dynamic_pointer_cast<CpuUtilAcceptor>(table));
+    cpu_manager->add_acceptor(pipeline.acceptor<CpuInfoAcceptor>(table));
+    cpu_manager->add_acceptor(pipeline.acceptor<CpuUtilAcceptor>(table));
+    cpu_manager->add_acceptor(pipeline.acceptor<CpuQuotaUtilAcceptor>(table));
     if (cpu_util_csv) {
-        cpu_manager->add_acceptor(cpu_util_csv);
+        cpu_manager->add_acceptor(pipeline.acceptor<CpuUtilAcceptor>(cpu_util_csv));
+        cpu_manager->add_acceptor(pipeline.acceptor<CpuQuotaUtilAcceptor>(cpu_util_csv));
+    }
+    if (attribution_csv) {
+        cpu_manager->add_acceptor(pipeline.acceptor<CpuStatAcceptor>(attribution_csv));
+    }
+    if (isolation_watchdog) {
+        cpu_manager->add_acceptor(pipeline.acceptor<CpuStatAcceptor>(isolation_watchdog));
     }
     if (pid_manager) {
-        pid_manager->add_acceptor(table);
+        pid_manager->add_acceptor(pipeline.acceptor<PidStatAcceptor>(table));
+        if (settings.run_queue && settings.all_pids) {
+            pid_manager->add_acceptor(pipeline.acceptor<CpuRunQueueAcceptor>(table));
+            if (cpu_util_csv) {
+                pid_manager->add_acceptor(pipeline.acceptor<CpuRunQueueAcceptor>(cpu_util_csv));
+            }
+        }
         if (pid_cpu_csv) {
-            pid_manager->add_acceptor(pid_cpu_csv);
+            pid_manager->add_acceptor(pipeline.acceptor<PidStatAcceptor>(pid_cpu_csv));
+        }
+        if (d_state_watchdog) {
+            pid_manager->add_acceptor(pipeline.acceptor<PidStatAcceptor>(d_state_watchdog));
+        }
+        if (uid_csv) {
+            pid_manager->add_acceptor(pipeline.acceptor<PidStatAcceptor>(uid_csv));
+        }
+        if (comm_csv) {
+            pid_manager->add_acceptor(pipeline.acceptor<PidStatAcceptor>(comm_csv));
+        }
+        if (attribution_csv) {
+            pid_manager->add_acceptor(pipeline.acceptor<PidStatAcceptor>(attribution_csv));
+        }
+        if (placement_csv) {
+            pid_manager->add_acceptor(pipeline.acceptor<ThreadPlacementAcceptor>(placement_csv));
+        }
+        if (isolation_watchdog) {
+            pid_manager->add_acceptor(pipeline.acceptor<PidStatAcceptor>(isolation_watchdog));
+        }
+    }
+    if (cpuidle_manager) {
+        cpuidle_manager->add_acceptor(pipeline.acceptor<CpuIdleStateInfoAcceptor>(cpuidle_csv));
+        cpuidle_manager->add_acceptor(pipeline.acceptor<CpuIdleResidencyAcceptor>(cpuidle_csv));
+    }
+    if (pressure_manager) {
+        pressure_manager->add_acceptor(pipeline.acceptor<PressureStatAcceptor>(pressure_csv));
+    }
+    if (cgroup_manager) {
+        cgroup_manager->add_acceptor(pipeline.acceptor<CgroupCpuStatAcceptor>(cgroup_csv));
+    }
+    if (perf_cpu_manager) {
+        perf_cpu_manager->add_acceptor(pipeline.acceptor<PerfCpuStatAcceptor>(perf_cpu_csv));
+    }
+    if (profile_manager) {
+        profile_manager->add_acceptor(pipeline.acceptor<FoldedStackAcceptor>(folded_stacks));
+    }
+    if (process_tree_manager) {
+        process_tree_manager->add_acceptor(pipeline.acceptor<ProcessTreeStatAcceptor>(table));
+        if (tree_csv) {
+            process_tree_manager->add_acceptor(pipeline.acceptor<ProcessTreeStatAcceptor>(tree_csv));
         }
     }
+    if (tick_csv) {
+        loop_state.scheduler.add_acceptor(pipeline.acceptor<TickStatAcceptor>(tick_csv));
+    }
 
     /* Initialize managers */
     for (auto const& manager: managers) {
         manager->Init();
     }
 
-    /* Setup signal handlers */
-    std::signal(SIGINT, HandleSignal);
-    std::signal(SIGTERM, HandleSignal);
+    /* Schedule managers with their own sampling periods */
+    loop_state.scheduler.set_proc_scan(proc_scan);
+    loop_state.scheduler.set_num_threads(std::min<size_t>(settings.sample_threads, std::max<size_t>(managers.size(), 1) - 1));
+    for (auto const& manager: managers) {
+        if (auto it = settings.periods_ms.find(ToString(manager->source())); it != settings.periods_ms.end()) {
+            manager->set_period(IntervalFromMs(it->second));
+        }
+        loop_state.scheduler.add_manager(manager);
+    }
 
     /* Start a worker thread */
-    std::thread worker{[settings, &managers, &consumers](){
-        MainLoop(settings.interval_ms, managers, consumers);
+    loop_state.pid_manager = pid_manager;
+    std::thread worker{[settings, &loop_state, &pipeline](){
+        MainLoop(IntervalFromMs(settings.interval_ms), loop_state, pipeline);
     }};
 
     /* Wait for worker to finish */
     worker.join();
-
-    for (auto const& manager: managers) {
-        manager->Finish();
-    }
 }